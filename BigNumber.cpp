@@ -11,29 +11,213 @@
 
 #include "BigNumber.h"
 
-int BigNumber::scale_ = 0;
+// ------------------------------ NATIVE VALUES -------------------------------
+
+// A number held natively is value_ / 10^scale_, with the sign, scale and
+// digits the bc_num for it would have: toNum makes that bc_num, and
+// demote takes back any bc_num that has no leading zeros, is not a
+// negative zero (which "-0.0" parses to) and fits. Native operations
+// give what the bc_num ones do, or leave it to them if they would overflow.
+
+// 10 to the power 0 to 18, which fit either NativeInt
+static const long long powersOf10 [19] = {
+  1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+  100000000LL, 1000000000LL, 10000000000LL, 100000000000LL,
+  1000000000000LL, 10000000000000LL, 100000000000000LL,
+  1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+  1000000000000000000LL
+};
+
+// all but the most negative value, which has no positive
+bool BigNumber::nativeFits (const NativeInt value)
+{
+  const NativeInt nativeMax =
+    (((NativeInt) 1 << (sizeof (NativeInt) * 8 - 2)) - 1) * 2 + 1;
+  return value >= -nativeMax;
+} // end of BigNumber::nativeFits
+
+// value times 10 to the power places, false if that overflows
+bool BigNumber::scaleUp (NativeInt & value, const int places)
+{
+  if (places <= 18)
+    return places <= 0 || !__builtin_mul_overflow (value, powersOf10 [places], &value);
+  return !__builtin_mul_overflow (value, powersOf10 [18], &value)
+         && scaleUp (value, places - 18);
+} // end of BigNumber::scaleUp
+
+void BigNumber::setNative (const NativeInt value, const int scale)
+{
+  bc_free_num (&num_);
+  value_ = value;
+  scale_ = scale;
+} // end of BigNumber::setNative
+
+// read the length chars at s natively as bc_str2num_n does, or return
+// false to leave them to it: a negative zero, too many digits or not a number
+bool BigNumber::parseNative (const char * s, const int length)
+{
+  const char * end = s + length;
+  const int scale = currentScale ();
+  bool negative = false;
+  bool point = false;
+  int digits = 0;
+  int places = 0;
+  NativeInt value = 0;
+
+  if (s < end && (*s == '+' || *s == '-'))
+    negative = (*s++ == '-');
+  for (; s < end; s++)
+  {
+    if (*s == '.' && !point)
+    {
+      point = true;
+      continue;
+    }
+    if (*s < '0' || *s > '9')
+      return false;
+    digits++;
+    if (point && places++ >= scale)
+      continue;  // cut to the scale
+    if (__builtin_mul_overflow (value, 10, &value)
+        || __builtin_add_overflow (value, *s - '0', &value))
+      return false;
+  }
+  places = MIN (places, scale);
+  if (digits == 0 || places > NativeScale || (negative && value == 0))
+    return false;
+
+  setNative (negative ? -value : value, places);
+  return true;
+} // end of BigNumber::parseNative
+
+// the 9 digits of part into reversed, least significant first
+static char * nineDigits (char * reversed, uint32_t part)
+{
+  for (int i = 0; i < 9; i++, part /= 10)
+    *reversed++ = part % 10;
+  return reversed;
+} // end of nineDigits
+
+// the digits of the native value into reversed, least significant first,
+// at least one before the decimal point; returns how many
+int BigNumber::nativeDigits (char * reversed) const
+{
+  NativeInt rest = (value_ < 0 ? -value_ : value_);
+  unsigned long long wide;
+  uint32_t part;
+  char * p = reversed;
+
+  // 9 digits at a time, divided in the narrowest type that holds the rest
+  while (rest >= powersOf10 [18])
+  {
+    wide = rest % powersOf10 [18];
+    rest /= powersOf10 [18];
+    p = nineDigits (p, wide % powersOf10 [9]);
+    p = nineDigits (p, wide / powersOf10 [9]);
+  }
+  for (wide = rest; wide >= (unsigned long long) powersOf10 [9]; wide /= powersOf10 [9])
+    p = nineDigits (p, wide % powersOf10 [9]);
+  part = wide;
+  do
+  {
+    *p++ = part % 10;
+    part /= 10;
+  } while (part != 0);
+  while (p - reversed <= scale_)
+    *p++ = 0;
+  return p - reversed;
+} // end of BigNumber::nativeDigits
+
+// the native value as bc_num2str_into writes it, with the NUL; returns the
+// length without it
+int BigNumber::nativeString (char * buffer) const
+{
+  char reversed [NativeScale + 1];
+  int count = nativeDigits (reversed);
+  char * p = buffer;
+
+  if (value_ < 0)
+    *p++ = '-';
+  while (count > scale_)
+    *p++ = '0' + reversed [--count];
+  if (count > 0)
+    *p++ = '.';
+  while (count > 0)
+    *p++ = '0' + reversed [--count];
+  *p = '\0';
+  return p - buffer;
+} // end of BigNumber::nativeString
+
+bc_num BigNumber::toNum () const
+{
+  if (num_ != NULL)
+    return bc_copy_num (num_);
+
+  char reversed [NativeScale + 1];
+  const int count = nativeDigits (reversed);
+  bc_num num = bc_new_num (count - scale_, scale_);
+  for (int i = 0; i < count; i++)
+    num->n_value [i] = reversed [count - 1 - i];
+  num->n_sign = (value_ < 0 ? MINUS : PLUS);
+  return num;
+} // end of BigNumber::toNum
+
+void BigNumber::setNum (bc_num num)
+{
+  bc_free_num (&num_);
+  num_ = num;
+  demote ();
+} // end of BigNumber::setNum
+
+void BigNumber::demote ()
+{
+  if (num_ == NULL || num_->n_scale > NativeScale
+      || num_->n_len + num_->n_scale > NativeScale + 1
+      || (num_->n_len > 1 && num_->n_value [0] == 0))
+    return;
+
+  NativeInt value = 0;
+  for (int i = 0; i < num_->n_len + num_->n_scale; i++)
+    if (__builtin_mul_overflow (value, 10, &value)
+        || __builtin_add_overflow (value, num_->n_value [i], &value))
+      return;
+  if (value == 0 && num_->n_sign == MINUS)
+    return;
+
+  setNative (num_->n_sign == MINUS ? -value : value, num_->n_scale);
+} // end of BigNumber::demote
+
+// ----------------------------------------------------------------------------
 
 // constructor
-BigNumber::BigNumber () : num_ (NULL)
+BigNumber::BigNumber () : num_ (NULL), value_ (0), scale_ (0)
 {
-  bc_init_num (&num_);  // default to zero
+  // default to zero
 } // end of constructor from string
 
 // constructor
-BigNumber::BigNumber (const char * s) : num_ (NULL)
+BigNumber::BigNumber (const char * s) : num_ (NULL), value_ (0), scale_ (0)
 {
-  bc_str2num(&num_, s, scale_);
+  const int length = strlen (s);
+  if (!parseNative (s, length))
+    bc_str2num_n(&num_, s, length, currentScale ());
 } // end of constructor from string
 
-BigNumber::BigNumber (const int n) : num_ (NULL)  // constructor from int
+// constructor from the first length chars of a string, which need not be terminated
+BigNumber::BigNumber (const char * s, const int length) : num_ (NULL), value_ (0), scale_ (0)
+{
+  if (!parseNative (s, length))
+    bc_str2num_n(&num_, s, length, currentScale ());
+} // end of constructor from string and length
+
+BigNumber::BigNumber (const int n) : num_ (NULL), value_ (n), scale_ (0)  // constructor from int
 {
-  bc_int2num (&num_, n);
 } // end of constructor from int
 
 // copy constructor
-BigNumber::BigNumber (const BigNumber & rhs)
+BigNumber::BigNumber (const BigNumber & rhs) : num_ (NULL), value_ (rhs.value_), scale_ (rhs.scale_)
 {
-  if (this != &rhs)
+  if (this != &rhs && rhs.num_ != NULL)
     num_ = bc_copy_num (rhs.num_);
 }  // end of BigNumber::BigNumber
 
@@ -45,7 +229,10 @@ BigNumber & BigNumber::operator= (const BigNumber & rhs)
     return *this;
 
   bc_free_num (&num_);  // get rid of old one
-  num_ = bc_copy_num (rhs.num_);
+  if (rhs.num_ != NULL)
+    num_ = bc_copy_num (rhs.num_);
+  value_ = rhs.value_;
+  scale_ = rhs.scale_;
   return *this;
 } // end of BigNumber::BigNumber & operator=
 
@@ -58,26 +245,33 @@ BigNumber::~BigNumber ()
 // set scale factor (number of places after the decimal point)
 int BigNumber::setScale (const int scale)
 {
-  int old_scale = scale_;
+  int old_scale = bc_current->c_scale;
   if (scale >= 0)
-    scale_ = scale;
+    bc_current->c_scale = scale;
   else
-    scale_ = 0;
+    bc_current->c_scale = 0;
   return old_scale;
 }  // end of BigNumber::setScale
 
+// switch the calling thread to another context
+bc_context * BigNumber::useContext (bc_context * ctx)
+{
+  return bc_use_context (ctx);
+}  // end of BigNumber::useContext
+
 // initialize package
 // supply scale (number of decimal places): default zero
 void BigNumber::begin (const int scale)
 {
   bc_init_numbers ();
-  scale_ = scale;
+  bc_current->c_scale = scale;
 } // end of BigNumber::begin
 
 // finished with package
-// free special numbers: zero, one, two
+// free special numbers: zero, one, two, and the cached constants
 void BigNumber::finish ()
 {
+  bc_free_math_constants ();
   bc_free_numbers ();
 } // end of BigNumber::finish
 
@@ -88,18 +282,57 @@ void BigNumber::finish ()
 //      free (s);
 char * BigNumber::toString () const
 {
-  return bc_num2str(num_);
+  if (num_ != NULL)
+    return bc_num2str(num_);
+
+  bc_num num = toNum ();
+  char * s = bc_num2str(num);
+  bc_free_num (&num);
+  return s;
+} // end of BigNumber::toString
+
+// write the number into a buffer of length chars, including the terminating NUL
+// eg:  char s [20];
+//      mynumber.toString (s, sizeof s);
+bool BigNumber::toString (char * buffer, const int length, int * needed) const
+{
+  if (num_ != NULL)
+    return bc_num2str_into (num_, buffer, length, needed) == 0;
+
+  char native [NativeScale + 5];
+  const int total = nativeString (native) + 1;
+  if (needed != NULL)
+    *needed = total;
+  if (length <= 0)
+    return false;
+  const int count = MIN (total, length);
+  memcpy (buffer, native, count - 1);
+  buffer [count - 1] = '\0';
+  return total <= length;
 } // end of BigNumber::toString
 
 BigNumber::operator long () const
 {
-  return bc_num2long (num_);
+  if (num_ != NULL)
+    return bc_num2long (num_);
+
+  NativeInt whole = value_;
+  for (int i = 0; i < scale_; i++)
+    whole /= 10;
+  if (whole > LONG_MAX || whole < -LONG_MAX)
+    return 0;  // too large, as bc_num2long
+  return whole;
 } // end of BigNumber::operator long
 
 // Allow Arduino's Serial.print() to print BigNumber objects!
 size_t BigNumber::printTo(Print& p) const
 {
-  char *buf = bc_num2str(num_);
+  // numbers that fit the buffer on the stack need no heap
+  char stackBuf [32];
+  if (toString (stackBuf, sizeof stackBuf))
+    return p.write(stackBuf);
+
+  char *buf = toString ();
   size_t len = p.write(buf);
   free(buf);
   return len;
@@ -108,109 +341,189 @@ size_t BigNumber::printTo(Print& p) const
 // add
 BigNumber & BigNumber::operator+= (const BigNumber & n)
 {
+  // both with the larger scale, as bc_add
+  const int scale = MAX (currentScale (), MAX (scale_, n.scale_));
+  NativeInt lhs = value_, rhs = n.value_, sum;
+  if (num_ == NULL && n.num_ == NULL && scale <= NativeScale
+      && scaleUp (lhs, scale - scale_) && scaleUp (rhs, scale - n.scale_)
+      && !__builtin_add_overflow (lhs, rhs, &sum) && nativeFits (sum))
+  {
+    setNative (sum, scale);
+    return *this;
+  }
+
   bc_num result = NULL;
-  bc_add (num_, n.num_, &result, scale_);
-  bc_free_num (&num_);
-  num_ = result;
+  bc_add (NumRef (*this), NumRef (n), &result, currentScale ());
+  setNum (result);
   return *this;
 } // end of BigNumber::operator+=
 
 // subtract
 BigNumber & BigNumber::operator-= (const BigNumber & n)
 {
+  const int scale = MAX (currentScale (), MAX (scale_, n.scale_));
+  NativeInt lhs = value_, rhs = n.value_, difference;
+  if (num_ == NULL && n.num_ == NULL && scale <= NativeScale
+      && scaleUp (lhs, scale - scale_) && scaleUp (rhs, scale - n.scale_)
+      && !__builtin_sub_overflow (lhs, rhs, &difference) && nativeFits (difference))
+  {
+    setNative (difference, scale);
+    return *this;
+  }
+
   bc_num result = NULL;
-  bc_sub (num_, n.num_, &result, scale_);
-  bc_free_num (&num_);
-  num_ = result;
+  bc_sub (NumRef (*this), NumRef (n), &result, currentScale ());
+  setNum (result);
   return *this;
 }  // end of BigNumber::operator-=
 
 // divide
 BigNumber & BigNumber::operator/= (const BigNumber & n)
 {
+  // the quotient truncated to the current scale, as bc_divide
+  const int scale = currentScale ();
+  const int places = scale + n.scale_ - scale_;
+  NativeInt dividend = value_, divisor = n.value_;
+  if (num_ == NULL && n.num_ == NULL && scale <= NativeScale
+      && scaleUp (dividend, places) && scaleUp (divisor, -places))
+  {
+    if (divisor == 0)
+      setNative (0, 0);
+    else
+      setNative (dividend / divisor, scale);
+    return *this;
+  }
+
   bc_num result = NULL;
   bc_init_num (&result);  // in case zero
-  bc_divide (num_, n.num_, &result, scale_);
-  bc_free_num (&num_);
-  num_ = result;
+  bc_divide (NumRef (*this), NumRef (n), &result, currentScale ());
+  setNum (result);
   return *this;
 } // end of BigNumber::operator/=
 
 // multiply
 BigNumber & BigNumber::operator*= (const BigNumber & n)
 {
+  // the product cut to the larger scale, or the current one if that is
+  // larger still, as bc_multiply
+  const int fullScale = scale_ + n.scale_;
+  const int scale = MIN (fullScale, MAX (currentScale (), MAX (scale_, n.scale_)));
+  NativeInt product, cut = 1;
+  if (num_ == NULL && n.num_ == NULL && scale <= NativeScale
+      && !__builtin_mul_overflow (value_, n.value_, &product) && nativeFits (product))
+  {
+    scaleUp (cut, fullScale - scale);  // both scales fit, so the cut does
+    setNative (product / cut, scale);
+    return *this;
+  }
+
   bc_num result = NULL;
-  bc_multiply (num_, n.num_, &result, scale_);
-  bc_free_num (&num_);
-  num_ = result;
+  bc_multiply (NumRef (*this), NumRef (n), &result, currentScale ());
+  setNum (result);
   return *this;
 }  // end of BigNumber::operator*=
 
 // modulo
 BigNumber & BigNumber::operator%= (const BigNumber & n)
 {
+  // less the quotient truncated to the current scale times n, as bc_modulo
+  const int scale = currentScale ();
+  const int places = scale + n.scale_ - scale_;
+  const int remScale = MAX (scale_, n.scale_ + scale);
+  NativeInt dividend = value_, divisor = n.value_, lhs = value_, rhs, remainder;
+  if (num_ == NULL && n.num_ == NULL && remScale <= NativeScale
+      && scaleUp (dividend, places) && scaleUp (divisor, -places))
+  {
+    if (divisor == 0)
+    {
+      setNative (0, 0);
+      return *this;
+    }
+    if (!__builtin_mul_overflow (dividend / divisor, n.value_, &rhs)
+        && scaleUp (lhs, remScale - scale_) && scaleUp (rhs, remScale - scale - n.scale_)
+        && !__builtin_sub_overflow (lhs, rhs, &remainder) && nativeFits (remainder))
+    {
+      setNative (remainder, remScale);
+      return *this;
+    }
+  }
+
   bc_num result = NULL;
   bc_init_num (&result);  // in case zero
-  bc_modulo (num_, n.num_, &result, scale_);
-  bc_free_num (&num_);
-  num_ = result;
+  bc_modulo (NumRef (*this), NumRef (n), &result, currentScale ());
+  setNum (result);
   return *this;
 }  // end of BigNumber::operator%=
 
 
 // ----------------------------- COMPARISONS ------------------------------
 
+int BigNumber::compare (const BigNumber & rhs) const
+{
+  const int scale = MAX (scale_, rhs.scale_);
+  NativeInt lhsValue = value_, rhsValue = rhs.value_;
+  if (num_ == NULL && rhs.num_ == NULL
+      && scaleUp (lhsValue, scale - scale_) && scaleUp (rhsValue, scale - rhs.scale_))
+    return (lhsValue > rhsValue) - (lhsValue < rhsValue);
+
+  return bc_compare (NumRef (*this), NumRef (rhs));
+} // end of BigNumber::compare
+
 // compare less with another BigNumber
 bool BigNumber::operator< (const BigNumber & rhs) const
 {
-  return bc_compare (num_, rhs.num_) < 0;
+  return compare (rhs) < 0;
 } // end of BigNumber::operator<
 
 
 // compare greater with another BigNumber
 bool BigNumber::operator> (const BigNumber & rhs) const
 {
-  return bc_compare (num_, rhs.num_) > 0;
+  return compare (rhs) > 0;
 } // end of BigNumber::operator>
 
 // compare less-or-equal with another BigNumber
 bool BigNumber::operator<= (const BigNumber & rhs) const
 {
-  return bc_compare (num_, rhs.num_) <= 0;
+  return compare (rhs) <= 0;
 } // end of BigNumber::operator<=
 
 // compare greater-or-equal with another BigNumber
 bool BigNumber::operator>= (const BigNumber & rhs) const
 {
-  return bc_compare (num_, rhs.num_) >= 0;
+  return compare (rhs) >= 0;
 } // end of BigNumber::operator>=
 
 // compare not equal with another BigNumber
 bool BigNumber::operator!= (const BigNumber & rhs) const
 {
-  return bc_compare (num_, rhs.num_) != 0;
+  return compare (rhs) != 0;
 } // end of BigNumber::operator!=
 
 // compare equal with another BigNumber
 bool BigNumber::operator== (const BigNumber & rhs) const
 {
-  return bc_compare (num_, rhs.num_) == 0;
+  return compare (rhs) == 0;
 } // end of BigNumber::operator==
 
 // special comparisons
 bool BigNumber::isNegative () const
 {
+  if (num_ == NULL)
+    return value_ < 0;
   return bc_is_neg (num_) == true;
 } // end of BigNumber::isNegative
 
 bool BigNumber::isZero () const
 {
+  if (num_ == NULL)
+    return value_ == 0;
   return bc_is_zero (num_) == true;
 } // end of BigNumber::isZero
 
 bool BigNumber::isNearZero () const
 {
-  return bc_is_near_zero (num_, scale_) == true;
+  return bc_is_near_zero (NumRef (*this), currentScale ()) == true;
 } // end of BigNumber::isNearZero
 
 // ----------------------------- OTHER OPERATIONS ------------------------------
@@ -218,8 +531,10 @@ bool BigNumber::isNearZero () const
 // square root
 BigNumber BigNumber::sqrt () const
 {
-  BigNumber result (*this);
-  bc_sqrt (&result.num_, scale_);
+  BigNumber result;
+  result.num_ = toNum ();
+  bc_sqrt (&result.num_, currentScale ());
+  result.demote ();
   return result;
 } // end of BigNumber::sqrt
 
@@ -227,19 +542,161 @@ BigNumber BigNumber::sqrt () const
 BigNumber BigNumber::pow (const BigNumber power) const
 {
   BigNumber result;
-  bc_raise (num_, power.num_, &result.num_, scale_);
+  bc_raise (NumRef (*this), NumRef (power), &result.num_, currentScale ());
+  result.demote ();
   return result;
 } // end of BigNumber::pow
 
 void BigNumber::divMod (const BigNumber divisor, BigNumber & quotient, BigNumber & remainder) const
 {
-  bc_divmod (num_, divisor.num_, &quotient.num_, &remainder.num_, scale_);
+  bc_num quot = quotient.toNum (), rem = remainder.toNum ();
+  bc_divmod (NumRef (*this), NumRef (divisor), &quot, &rem, currentScale ());
+  quotient.setNum (quot);
+  remainder.setNum (rem);
 }
 
 // raise number by power, modulus modulus
 BigNumber BigNumber::powMod (const BigNumber power, const BigNumber & modulus) const
 {
   BigNumber result;
-  bc_raisemod (num_, power.num_, modulus.num_, &result.num_, scale_);
+  bc_raisemod (NumRef (*this), NumRef (power), NumRef (modulus), &result.num_, currentScale ());
+  result.demote ();
   return result;
 }
+
+// multiply by 10 to the power places
+BigNumber BigNumber::shift10 (const int places) const
+{
+  // digits move, the scale grows only for a negative places, as bc_shift10
+  NativeInt value = value_;
+  if (num_ == NULL && scale_ - MIN (places, 0) <= NativeScale
+      && scaleUp (value, places) && nativeFits (value))
+  {
+    BigNumber result;
+    result.setNative (value, scale_ - MIN (places, 0));
+    return result;
+  }
+
+  BigNumber result;
+  bc_shift10 (NumRef (*this), places, &result.num_);
+  result.demote ();
+  return result;
+} // end of BigNumber::shift10
+
+// multiply by a small number
+BigNumber BigNumber::mulSmall (const unsigned long n) const
+{
+  // keeping the scale, as bc_mul_small
+  NativeInt product;
+  if (num_ == NULL && !__builtin_mul_overflow (value_, n, &product) && nativeFits (product))
+  {
+    BigNumber result;
+    result.setNative (product, scale_);
+    return result;
+  }
+
+  BigNumber result;
+  bc_mul_small (NumRef (*this), n, &result.num_);
+  result.demote ();
+  return result;
+} // end of BigNumber::mulSmall
+
+// divide by a small number, optionally giving the remainder
+BigNumber BigNumber::divSmall (const unsigned long n, unsigned long * remainder) const
+{
+  BigNumber result;  // zero, in case n is
+  bc_div_small (NumRef (*this), n, &result.num_, remainder, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::divSmall
+
+// add a small number
+BigNumber BigNumber::addSmall (const unsigned long n) const
+{
+  BigNumber result;
+  if (num_ == NULL)
+  {
+    // as adding it as a BigNumber, where it fits one
+    BigNumber addend;
+    if (!__builtin_add_overflow (n, 0, &addend.value_))
+    {
+      result = *this;
+      result += addend;
+      return result;
+    }
+  }
+  bc_add_small (NumRef (*this), n, &result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::addSmall
+
+// ------------------------- TRANSCENDENTAL FUNCTIONS --------------------------
+
+// e to the power of this number
+BigNumber BigNumber::exp () const
+{
+  BigNumber result;
+  bc_exp (NumRef (*this), &result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::exp
+
+// natural logarithm
+BigNumber BigNumber::ln () const
+{
+  BigNumber result;
+  bc_ln (NumRef (*this), &result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::ln
+
+// sine
+BigNumber BigNumber::sin () const
+{
+  BigNumber result;
+  bc_sin (NumRef (*this), &result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::sin
+
+// cosine
+BigNumber BigNumber::cos () const
+{
+  BigNumber result;
+  bc_cos (NumRef (*this), &result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::cos
+
+// arc tangent
+BigNumber BigNumber::atan () const
+{
+  BigNumber result;
+  bc_atan (NumRef (*this), &result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::atan
+
+BigNumber BigNumber::pi ()
+{
+  BigNumber result;
+  bc_pi (&result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::pi
+
+BigNumber BigNumber::e ()
+{
+  BigNumber result;
+  bc_e (&result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::e
+
+BigNumber BigNumber::ln2 ()
+{
+  BigNumber result;
+  bc_ln2 (&result.num_, currentScale ());
+  result.demote ();
+  return result;
+} // end of BigNumber::ln2
@@ -12,29 +12,73 @@
 #define _BigNumber_h
 
 #include <stddef.h>
+#include <limits.h>
 #include <Arduino.h>
 
 extern "C"
 {
 #include "number.h"
+#include "bcmath.h"
 }
 
 class BigNumber : public Printable
 {
 
-    // the current scaling amount - shared amongst all BigNumbers
-    static int scale_;
+    // the current scaling amount - kept in the current bc_context, so
+    // shared amongst all BigNumbers of a thread that use the same context
+    static int currentScale () {
+      return bc_current->c_scale;
+    }
+
+    // values that fit are held natively, as value_ / 10^scale_, with num_ NULL;
+    // they go to a bc_num when an operation overflows or needs more places
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef __int128 NativeInt;
+#else
+    typedef long long NativeInt;
+#endif
+    // most places after the decimal point held natively, 10^NativeScale fits
+    static const int NativeScale = (sizeof (NativeInt) == 16 ? 38 : 18);
 
-    // member variable (the big number)
+    // member variables (the big number, or the native one)
     bc_num        num_;
+    NativeInt     value_;
+    int           scale_;
+
+    // a bc_num of the value for the length of a call, eg. bc_sqrt (NumRef (x), ...)
+    class NumRef
+    {
+        bc_num num_;
+      public:
+        NumRef (const BigNumber & n) : num_ (n.toNum ()) {}
+        ~NumRef () {
+          bc_free_num (&num_);
+        }
+        operator bc_num () const {
+          return num_;
+        }
+    };
+
+    static bool nativeFits (const NativeInt value);
+    static bool scaleUp (NativeInt & value, const int places);
+    void setNative (const NativeInt value, const int scale);
+    bool parseNative (const char * s, const int length);
+    int nativeDigits (char * reversed) const;
+    int nativeString (char * buffer) const;
+    bc_num toNum () const;  // a new bc_num of the value, MUST FREE IT after use
+    void setNum (bc_num num);  // take num over
+    void demote ();  // back to native if num_ fits
+    int compare (const BigNumber & rhs) const;  // as bc_compare
 
   public:
 
     // constructors
     BigNumber ();  // default constructor
     BigNumber (const char * s);   // constructor from string
+    BigNumber (const char * s, const int length);  // from the first length chars of s
     BigNumber (const int n);  // constructor from int
-    // copy constructor
+    // copy constructor - the copy shares the digits, which are never changed;
+    // with the library built with BC_THREADSAFE it may be used on another thread
     BigNumber (const BigNumber & rhs);
 
     // destructor
@@ -44,9 +88,16 @@ class BigNumber : public Printable
     static void begin (const int scale = 0);
     static void finish ();  // free memory used by 'begin' method
     static int setScale (const int scale = 0);
+    // work in ctx (set up by bc_init_context) on this thread from now on, or
+    // in the default context if ctx is NULL; returns the context used before.
+    // The scale and the constants go with the context.
+    static bc_context * useContext (bc_context * ctx);
 
     // for outputting purposes ...
     char * toString () const;  // returns number as string, MUST FREE IT after use!
+    // writes number into buffer of length chars (with the NUL), cut to fit; nothing to free
+    // returns false if it was cut, needed (if given) gets the length it takes
+    bool toString (char * buffer, const int length, int * needed = NULL) const;
     operator long () const;
     virtual size_t printTo(Print& p) const; // for Arduino Serial.print()
 
@@ -155,6 +206,26 @@ class BigNumber : public Printable
     // raise number by power, modulus modulus
     BigNumber powMod (const BigNumber power, const BigNumber & modulus) const;
 
+    // operations with a small operand, one pass over the digits
+    // (native arithmetic while the number is held natively)
+    // multiply by 10 to the power places (divide, if negative), losing nothing
+    BigNumber shift10 (const int places) const;
+    BigNumber mulSmall (const unsigned long n) const;
+    // divide by n, the part left over goes to remainder if it is not NULL
+    BigNumber divSmall (const unsigned long n, unsigned long * remainder = NULL) const;
+    BigNumber addSmall (const unsigned long n) const;
+
+    // transcendental functions to the current scale, angles in radians
+    BigNumber exp () const;
+    BigNumber ln () const;   // zero if the number is not above zero
+    BigNumber sin () const;
+    BigNumber cos () const;
+    BigNumber atan () const;
+    // constants, kept once computed until 'finish'
+    static BigNumber pi ();
+    static BigNumber e ();
+    static BigNumber ln2 ();
+
 };  // end class declaration
 
 
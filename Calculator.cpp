@@ -7,6 +7,58 @@
 
 #include "Calculator.h"
 
+/**
+   \brief Work an operation on two numbers as CalculatorNumber.
+   \param[out] resultant the worked number.
+   \param[in] lhs number left of the operation.
+   \param[in] rhs number right of the operation.
+   \param[in] operation one of '+', '-', '*' or '/'.
+   \param[in] scale fraction digits, as the BigNumber scale.
+   \return false if the numbers or the resultant do not fit.
+*/
+static FIXED_DECIMAL_CONSTEXPR bool fixedCalculate(CalculatorNumber &resultant, const char *lhs, const char *rhs, char operation, uint8_t scale) {
+  CalculatorNumber fixed0, fixed1, zero;
+  if (!fixed0.parse(lhs, scale) || !fixed1.parse(rhs, scale)) {
+    return false;
+  }
+  if (operation == '+') {
+    return CalculatorNumber::add(fixed0, fixed1, resultant, scale);
+  } else if (operation == '-') {
+    return CalculatorNumber::sub(fixed0, fixed1, resultant, scale);
+  } else if (operation == '*') {
+    return CalculatorNumber::multiply(fixed0, fixed1, resultant, scale)
+           && CalculatorNumber::add(resultant, zero, resultant, scale); // same decimal as the BigNumber path in calculate().
+  }
+  return CalculatorNumber::divide(fixed0, fixed1, resultant, scale);
+}
+
+#if FIXED_DECIMAL_CONSTEXPR_OK
+/**
+   \brief Compile time check of fixedCalculate() at the scale of a CALCULATOR_DIGITS wide Calculator.
+   \param[in] expect what BigNumber prints for the operation, or NULL if it should not fit.
+*/
+static constexpr bool calculatesTo(const char *lhs, char operation, const char *rhs, const char *expect) {
+  CalculatorNumber resultant;
+  char resultStr[CalculatorNumber::StringSize] = {};
+  if (!fixedCalculate(resultant, lhs, rhs, operation, CALCULATOR_DIGITS - 1)) {
+    return expect == NULL;
+  }
+  resultant.toString(resultStr);
+  uint8_t i = 0;
+  while ((expect != NULL) && (expect[i] != '\0') && (resultStr[i] == expect[i])) i++;
+  return (expect != NULL) && (resultStr[i] == expect[i]);
+}
+
+static_assert(calculatesTo("1.5", '+', "2.25", "3.75000000"), "add keeps the scale");
+static_assert(calculatesTo("2.", '-', "7.", "-5.00000000"), "sub goes negative");
+static_assert(calculatesTo("-0.", '+', "0.", "0.00000000"), "zero is positive");
+static_assert(calculatesTo("0.00000003", '*', "0.5", "0.00000001"), "multiply truncates");
+static_assert(calculatesTo("123456789.", '*', "987654321.", "121932631112635269.00000000"), "multiply to 2 * Digits");
+static_assert(calculatesTo("1.", '/', "3.", "0.33333333"), "divide truncates");
+static_assert(calculatesTo("-1.", '/', "0.", "0"), "divide by zero");
+static_assert(calculatesTo("999999999999999999.", '+', "1.", NULL), "sum past 2 * Digits");
+#endif
+
 /**
    \brief Constructor
    \param[in] size of memory to allocate for char arrays.
@@ -27,7 +79,11 @@ Calculator::Calculator(int _size) {
   byte lastKeyWasAnOperation = 0;
   char operationChar = NULL;
   bool noNewNumberSinceLastCalculation = false;
-  BigNumber::begin (_size - 1); // account for zero infront of decimal point.
+  _scale = _size - 1; // account for zero infront of decimal point.
+
+  // a BigNumber context of its own, so Calculators of different sizes (or on different threads) do not share a scale.
+  bc_init_context(&_context);
+  _context.c_scale = _scale;
 }
 
 /**
@@ -38,6 +94,7 @@ Calculator::Calculator(int _size) {
 Calculator::~Calculator() {
   free(numStr0);
   free(numStr1);
+  bc_free_context(&_context);
 }
 
 /**
@@ -64,6 +121,83 @@ void Calculator::zeroStr(char *dest, int length) {
   dest[1] = '.'; // initial value is Zero Text.
 }
 
+/**
+   \brief Work out an operation on two numbers.
+   \param[out] dest pointer to target char array for the resultant.
+   \param[in] length size of dest, the resultant is cut to fit.
+   \param[in] lhs number left of the operation.
+   \param[in] rhs number right of the operation.
+   \param[in] operation one of '+', '-', '*' or '/'.
+   \return false if there is no operation to do.
+
+   The numbers are worked as CalculatorNumber, on the stack, and only when
+   the resultant does not fit there is the calculation redone with BigNumber.
+   Either way the resultant text is the same.
+*/
+bool Calculator::calculate(char *dest, int length, const char *lhs, const char *rhs, char operation) {
+  if ((operation != '+') && (operation != '-') && (operation != '*') && (operation != '/')) {
+    return false;
+  }
+
+  CalculatorNumber fixedResultant;
+  if (fixedCalculate(fixedResultant, lhs, rhs, operation, _scale)) {
+    char resultStr[CalculatorNumber::StringSize];
+    fixedResultant.toString(resultStr);
+    strncpy(dest, resultStr, length - 1);
+    dest[length - 1] = '\0';
+    return true;
+  }
+
+  IFDEBUG(Serial.println("resultant does not fit, using BigNumber"));
+  BigNumber resultant;
+  if (operation == '+') {
+    IFDEBUG(Serial.println("Adding"));
+    resultant = BigNumber (lhs) + BigNumber (rhs);
+
+  } else if (operation == '-') {
+    IFDEBUG(Serial.println("subtracting"));
+    resultant = BigNumber (lhs) - BigNumber (rhs);
+
+  } else if (operation == '*') {
+    IFDEBUG(Serial.println("Multiplying"));
+    resultant = BigNumber (lhs) * BigNumber (rhs);
+    resultant = resultant + BigNumber("0"); // for some dumb reason BigNumber does not show decimal after a multiply, so adding it for consistency.
+
+  } else {
+    IFDEBUG(Serial.println("Dividing"));
+    resultant = BigNumber (lhs) / BigNumber (rhs);
+  }
+
+  resultant.toString(dest, length); // cut to the proper length.
+  return true;
+}
+
+/**
+   \brief Shift a new digit into the right of a displayed number.
+   \param[out] dest pointer to target char array.
+   \param[in] length size of dest, the new number is cut to fit.
+   \param[in] display number currently displayed.
+   \param[in] digit an ASCII Char value. [0-9]
+*/
+void Calculator::appendDigit(char *dest, int length, const char *display, char digit) {
+  const char digitStr[2] = {digit, '\0'};
+  CalculatorNumber number, ten, newDigit;
+
+  if (number.parse(display, _scale) && ten.parse("10", 0) && newDigit.parse(digitStr, 0)
+      && CalculatorNumber::multiply(number, ten, number, _scale)
+      && CalculatorNumber::add(number, newDigit, number, _scale)) {
+    char resultStr[CalculatorNumber::StringSize];
+    number.toString(resultStr);
+    strncpy(dest, resultStr, length - 1);
+    dest[length - 1] = '\0';
+    return;
+  }
+
+  // convert it to a number and back to get decimal.
+  BigNumber tempNumber = BigNumber(display).shift10(1).addSmall(digit - '0');
+  tempNumber.toString(dest, length); // cut to the proper length.
+}
+
 /**
    \brief Parse A digit into the Calculator.
    \param[in] an ASCII Char value. [0-9+-*\/nCc]
@@ -87,6 +221,7 @@ void Calculator::zeroStr(char *dest, int length) {
 */
 void Calculator::parse(char *output, char inByte) {
 
+  bc_context *callersContext = BigNumber::useContext(&_context); // BigNumbers below work in this Calculator's context.
   int displayStrLength = strlen(displayStr);
 
   if ((inByte == '+') || (inByte == '-') || (inByte == '*') || (inByte == '/')) {
@@ -109,37 +244,7 @@ void Calculator::parse(char *output, char inByte) {
     // primary input buffer for next number.
     zeroStr(displayStr, _displayStrSize);
 
-    BigNumber resultant;
-    bool didCalulation = false;
-    if (operationChar == '+') {
-      IFDEBUG(Serial.println("Adding"));
-      resultant = BigNumber (numStr0) + BigNumber (numStr1);
-      didCalulation = true;
-
-    } else if (operationChar == '-') {
-      IFDEBUG(Serial.println("subtracting"));
-      resultant = BigNumber (numStr0) - BigNumber (numStr1);
-      didCalulation = true;
-
-    } else if (operationChar == '*') {
-      IFDEBUG(Serial.println("Multiplying"));
-      resultant = BigNumber (numStr0) * BigNumber (numStr1);
-      resultant = resultant + BigNumber("0"); // for some dumb reason BigNumber does not show decimal after a multiply, so adding it for consistency.
-
-      didCalulation = true;
-
-    } else if (operationChar == '/') {
-      IFDEBUG(Serial.println("Dividing"));
-      resultant = BigNumber (numStr0) / BigNumber (numStr1);
-      didCalulation = true;
-
-    }
-
-    if (didCalulation == true) {
-      char * tempChar = resultant.toString();
-      tempChar[_numStrSize - 1] = NULL; // need to size the new string to proper length.
-      strcpy(numStr0, tempChar);
-
+    if (calculate(numStr0, _numStrSize, numStr0, numStr1, operationChar)) {
       //remove Zero Padding. Note resultant string will always have decimal point.
       for (int8_t i = (_numStrSize - 2) ; ((i > 0) && (numStr0[i] == '0')); i--) {
         numStr0[i] = NULL;
@@ -210,11 +315,7 @@ void Calculator::parse(char *output, char inByte) {
     } else {
       IFDEBUG(Serial.println("adding new byte to end of display str."));
 
-      // convert it to a number and back to get decimal.
-      BigNumber tempNumber = (BigNumber(displayStr) * BigNumber(10)) + BigNumber(inByte - '0');
-      char * tempChar = tempNumber.toString();
-      tempChar[_displayStrSize - 1] = NULL; // need to size the new string to proper length.
-      strcpy(displayStr, tempChar);
+      appendDigit(displayStr, _displayStrSize, displayStr, inByte);
 
       //remove Zero Padding. Note resultant string will always have decimal point.
       for (int8_t i = (_displayStrSize - 2) ; ((i > 0) && (displayStr[i] == '0')); i--) {
@@ -235,4 +336,5 @@ void Calculator::parse(char *output, char inByte) {
   IFDEBUG(Serial.print("..SinceLastC.. = \"")); IFDEBUG(Serial.print(noNewNumberSinceLastCalculation)); IFDEBUG(Serial.print("\" "));
 
   IFDEBUG(Serial.println());
+  BigNumber::useContext(callersContext);
 }
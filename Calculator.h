@@ -6,11 +6,16 @@
 */
 
 #include "BigNumber.h"
+#include "FixedDecimal.h"
 
 #define IFDEBUG(...) ((void)((DEBUG_LEVEL) && (__VA_ARGS__, 0)))
 
 #define DEBUG_LEVEL 0 // set to 1 to compile in Serial Debug prints
 
+#define CALCULATOR_DIGITS 9 // widest display served without BigNumber, matches DISPLAY_SIZE.
+
+typedef FixedDecimal<CALCULATOR_DIGITS, CALCULATOR_DIGITS - 1> CalculatorNumber; // fraction digits as Calculator(CALCULATOR_DIGITS) scales them.
+
 class Calculator {
   private:
     byte lastKeyWasAnOperation;
@@ -21,7 +26,11 @@ class Calculator {
     char* numStr0;
     char* numStr1;
     int _numStrSize;
+    int _scale;
+    bc_context _context; // BigNumber constants, scale and caches of this Calculator.
     void zeroStr(char *dest, int length);
+    bool calculate(char *dest, int length, const char *lhs, const char *rhs, char operation);
+    void appendDigit(char *dest, int length, const char *display, char digit);
 
   public:
     Calculator(int _size);
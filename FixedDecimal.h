@@ -0,0 +1,399 @@
+/**
+  \file FixedDecimal.h
+  \brief Heap free decimal number sized for a fixed calculator display.
+  \remarks comments are implemented with Doxygen Markdown format
+*/
+
+#ifndef FixedDecimal_h
+#define FixedDecimal_h
+
+#include "Arduino.h"
+
+/**
+   With C++14 every operation is constexpr, so results can be worked out at
+   compile time and checked with static_assert. Older compilers get the same
+   code as plain functions and FIXED_DECIMAL_CONSTEXPR_OK stays 0.
+*/
+#if __cplusplus >= 201402L
+#define FIXED_DECIMAL_CONSTEXPR constexpr
+#define FIXED_DECIMAL_CONSTEXPR_OK 1
+#else
+#define FIXED_DECIMAL_CONSTEXPR
+#define FIXED_DECIMAL_CONSTEXPR_OK 0
+#endif
+
+/**
+   Loops over the digits run a compile time count, set by the template
+   arguments, so GCC 8 and later unroll them into straight-line code. Not on
+   AVR, where flash is scarcer than cycles.
+*/
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 8) && !defined(__AVR__)
+#define FIXED_DECIMAL_UNROLL _Pragma("GCC unroll 64")
+#else
+#define FIXED_DECIMAL_UNROLL
+#endif
+
+/**
+ * \class FixedDecimal
+ * \brief Decimal number for a Digits wide display that lives on the stack.
+
+   Holds 2 * Digits integer digits and Scale fraction digits, one per byte,
+   and follows the sign and scale rules of the bc_num behind BigNumber. So
+   toString() prints exactly what BigNumber would have printed for the same
+   calculation. An operation whose result needs more integer digits, or more
+   than Scale fraction digits, returns false, and the caller redoes the
+   calculation with BigNumber.
+ */
+template <uint8_t Digits, uint8_t Scale = Digits>
+class FixedDecimal {
+
+  public:
+    static const uint8_t IntDigits = 2 * Digits;
+    static const uint8_t FracDigits = Scale;
+    static const uint8_t Size = IntDigits + FracDigits;
+    static const uint8_t StringSize = Size + 3; ///< one each for sign, decimal point and str NULL terminator.
+
+    FIXED_DECIMAL_CONSTEXPR FixedDecimal() : _digit(), _negative(false), _scale(0) {
+    }
+
+    FIXED_DECIMAL_CONSTEXPR bool parse(const char *str, uint8_t scale);
+    FIXED_DECIMAL_CONSTEXPR void toString(char *dest) const;
+
+    static FIXED_DECIMAL_CONSTEXPR bool add(const FixedDecimal &n1, const FixedDecimal &n2, FixedDecimal &result, uint8_t scaleMin);
+    static FIXED_DECIMAL_CONSTEXPR bool sub(const FixedDecimal &n1, const FixedDecimal &n2, FixedDecimal &result, uint8_t scaleMin);
+    static FIXED_DECIMAL_CONSTEXPR bool multiply(const FixedDecimal &n1, const FixedDecimal &n2, FixedDecimal &result, uint8_t scale);
+    static FIXED_DECIMAL_CONSTEXPR bool divide(const FixedDecimal &n1, const FixedDecimal &n2, FixedDecimal &result, uint8_t scale);
+
+  private:
+    uint8_t _digit[Size]; // most significant first, decimal point after IntDigits.
+    bool _negative;
+    uint8_t _scale;       // digits after the decimal point that get printed.
+
+    FIXED_DECIMAL_CONSTEXPR void clear();
+    FIXED_DECIMAL_CONSTEXPR bool isZero() const;
+    static FIXED_DECIMAL_CONSTEXPR bool isDigit(char c) {
+      return (c >= '0') && (c <= '9');
+    }
+    template <uint8_t Length>
+    static FIXED_DECIMAL_CONSTEXPR int8_t compare(const uint8_t *a, const uint8_t *b);
+    template <uint8_t Length>
+    static FIXED_DECIMAL_CONSTEXPR bool addDigits(const uint8_t *a, const uint8_t *b, uint8_t *result);
+    template <uint8_t Length>
+    static FIXED_DECIMAL_CONSTEXPR void subDigits(const uint8_t *a, const uint8_t *b, uint8_t *result);
+};
+
+/**
+   \brief Set to zero with no fraction digits.
+*/
+template <uint8_t Digits, uint8_t Scale>
+FIXED_DECIMAL_CONSTEXPR void FixedDecimal<Digits, Scale>::clear() {
+  FIXED_DECIMAL_UNROLL
+  for (uint8_t i = 0; i < Size; i++) {
+    _digit[i] = 0;
+  }
+  _negative = false;
+  _scale = 0;
+}
+
+/**
+   \brief Test every digit for zero.
+*/
+template <uint8_t Digits, uint8_t Scale>
+FIXED_DECIMAL_CONSTEXPR bool FixedDecimal<Digits, Scale>::isZero() const {
+  uint8_t any = 0;
+  FIXED_DECIMAL_UNROLL
+  for (uint8_t i = 0; i < Size; i++) {
+    any |= _digit[i];
+  }
+  return any == 0;
+}
+
+/**
+   \brief Compare two digit strings of Length digits.
+   \return -1, 0 or 1 as a is less than, equal to or greater than b.
+*/
+template <uint8_t Digits, uint8_t Scale>
+template <uint8_t Length>
+FIXED_DECIMAL_CONSTEXPR int8_t FixedDecimal<Digits, Scale>::compare(const uint8_t *a, const uint8_t *b) {
+  for (uint8_t i = 0; i < Length; i++) {
+    if (a[i] != b[i]) {
+      return (a[i] > b[i]) ? 1 : -1;
+    }
+  }
+  return 0;
+}
+
+/**
+   \brief Add two digit strings of Length digits.
+   \return true if a carry was left over the top digit.
+*/
+template <uint8_t Digits, uint8_t Scale>
+template <uint8_t Length>
+FIXED_DECIMAL_CONSTEXPR bool FixedDecimal<Digits, Scale>::addDigits(const uint8_t *a, const uint8_t *b, uint8_t *result) {
+  uint8_t carry = 0;
+  FIXED_DECIMAL_UNROLL
+  for (int8_t i = Length - 1; i >= 0; i--) {
+    uint8_t sum = a[i] + b[i] + carry;
+    carry = (sum > 9);
+    result[i] = carry ? sum - 10 : sum;
+  }
+  return carry;
+}
+
+/**
+   \brief Subtract digit string b from the larger digit string a, both of Length digits.
+*/
+template <uint8_t Digits, uint8_t Scale>
+template <uint8_t Length>
+FIXED_DECIMAL_CONSTEXPR void FixedDecimal<Digits, Scale>::subDigits(const uint8_t *a, const uint8_t *b, uint8_t *result) {
+  uint8_t borrow = 0;
+  FIXED_DECIMAL_UNROLL
+  for (int8_t i = Length - 1; i >= 0; i--) {
+    int8_t diff = a[i] - b[i] - borrow;
+    borrow = (diff < 0);
+    result[i] = borrow ? diff + 10 : diff;
+  }
+}
+
+/**
+   \brief Load a number from text the way bc_str2num does.
+   \param[in] str number text, optional sign then [digits][.digits].
+   \param[in] scale most fraction digits to keep; the rest are dropped.
+   \return false if the number has more integer digits than fit.
+
+   Text that is not a number reads as zero, as it does for BigNumber.
+*/
+template <uint8_t Digits, uint8_t Scale>
+FIXED_DECIMAL_CONSTEXPR bool FixedDecimal<Digits, Scale>::parse(const char *str, uint8_t scale) {
+  const char *ptr = str;
+  int digits = 0;
+  int strScale = 0;
+
+  clear();
+  if ((*ptr == '+') || (*ptr == '-')) ptr++;
+  while (*ptr == '0') ptr++;
+  const char *intStart = ptr;
+  while (isDigit(*ptr)) ptr++, digits++;
+  if (*ptr == '.') ptr++;
+  const char *fracStart = ptr;
+  while (isDigit(*ptr)) ptr++, strScale++;
+  if ((*ptr != '\0') || (digits + strScale == 0)) {
+    return true;
+  }
+  if ((digits > IntDigits) || (scale > FracDigits)) {
+    return false;
+  }
+
+  if (strScale > scale) strScale = scale;
+  _negative = (*str == '-');
+  _scale = strScale;
+  for (uint8_t i = 0; i < digits; i++) {
+    _digit[IntDigits - digits + i] = intStart[i] - '0';
+  }
+  for (uint8_t i = 0; i < strScale; i++) {
+    _digit[IntDigits + i] = fracStart[i] - '0';
+  }
+  return true;
+}
+
+/**
+   \brief Print the number the way bc_num2str does.
+   \param[out] dest buffer of at least StringSize chars.
+*/
+template <uint8_t Digits, uint8_t Scale>
+FIXED_DECIMAL_CONSTEXPR void FixedDecimal<Digits, Scale>::toString(char *dest) const {
+  uint8_t i = 0;
+
+  if (_negative) *dest++ = '-';
+  while ((i < IntDigits - 1) && (_digit[i] == 0)) i++;
+  for (; i < IntDigits; i++) {
+    *dest++ = '0' + _digit[i];
+  }
+  if (_scale > 0) {
+    *dest++ = '.';
+    for (i = 0; i < _scale; i++) {
+      *dest++ = '0' + _digit[IntDigits + i];
+    }
+  }
+  *dest = '\0';
+}
+
+/**
+   \brief result = n1 + n2, with at least scaleMin fraction digits.
+   \return false if the sum does not fit.
+*/
+template <uint8_t Digits, uint8_t Scale>
+FIXED_DECIMAL_CONSTEXPR bool FixedDecimal<Digits, Scale>::add(const FixedDecimal &n1, const FixedDecimal &n2, FixedDecimal &result, uint8_t scaleMin) {
+  FixedDecimal sum;
+  uint8_t scale = (n1._scale > n2._scale) ? n1._scale : n2._scale;
+
+  if (scaleMin > scale) scale = scaleMin;
+  if (scale > FracDigits) {
+    return false;
+  }
+
+  if (n1._negative == n2._negative) {
+    if (addDigits<Size>(n1._digit, n2._digit, sum._digit)) {
+      return false;
+    }
+    sum._negative = n1._negative;
+  } else {
+    switch (compare<Size>(n1._digit, n2._digit)) {
+      case -1:
+        subDigits<Size>(n2._digit, n1._digit, sum._digit);
+        sum._negative = n2._negative;
+        break;
+      case 0:
+        break; // zero, positive.
+      default:
+        subDigits<Size>(n1._digit, n2._digit, sum._digit);
+        sum._negative = n1._negative;
+        break;
+    }
+  }
+
+  sum._scale = scale;
+  result = sum;
+  return true;
+}
+
+/**
+   \brief result = n1 - n2, with at least scaleMin fraction digits.
+   \return false if the difference does not fit.
+*/
+template <uint8_t Digits, uint8_t Scale>
+FIXED_DECIMAL_CONSTEXPR bool FixedDecimal<Digits, Scale>::sub(const FixedDecimal &n1, const FixedDecimal &n2, FixedDecimal &result, uint8_t scaleMin) {
+  FixedDecimal difference;
+  uint8_t scale = (n1._scale > n2._scale) ? n1._scale : n2._scale;
+
+  if (scaleMin > scale) scale = scaleMin;
+  if (scale > FracDigits) {
+    return false;
+  }
+
+  if (n1._negative != n2._negative) {
+    if (addDigits<Size>(n1._digit, n2._digit, difference._digit)) {
+      return false;
+    }
+    difference._negative = n1._negative;
+  } else {
+    switch (compare<Size>(n1._digit, n2._digit)) {
+      case -1:
+        subDigits<Size>(n2._digit, n1._digit, difference._digit);
+        difference._negative = !n2._negative;
+        break;
+      case 0:
+        break; // zero, positive.
+      default:
+        subDigits<Size>(n1._digit, n2._digit, difference._digit);
+        difference._negative = n1._negative;
+        break;
+    }
+  }
+
+  difference._scale = scale;
+  result = difference;
+  return true;
+}
+
+/**
+   \brief result = n1 * n2, truncated the way bc_multiply does.
+   \param[in] scale wanted fraction digits; the result keeps
+   MIN(n1 scale + n2 scale, MAX(scale, n1 scale, n2 scale)).
+   \return false if the product does not fit.
+*/
+template <uint8_t Digits, uint8_t Scale>
+FIXED_DECIMAL_CONSTEXPR bool FixedDecimal<Digits, Scale>::multiply(const FixedDecimal &n1, const FixedDecimal &n2, FixedDecimal &result, uint8_t scale) {
+  uint8_t product[2 * Size] = {};
+  uint8_t fullScale = n1._scale + n2._scale;
+  uint8_t prodScale = (n1._scale > n2._scale) ? n1._scale : n2._scale;
+
+  if (scale > prodScale) prodScale = scale;
+  if (fullScale < prodScale) prodScale = fullScale;
+  if (prodScale > FracDigits) {
+    return false;
+  }
+
+  for (int8_t i = Size - 1; i >= 0; i--) {
+    uint8_t carry = 0;
+    if (n1._digit[i] == 0) continue;
+    FIXED_DECIMAL_UNROLL
+    for (int8_t j = Size - 1; j >= 0; j--) {
+      uint8_t sum = product[i + j + 1] + n1._digit[i] * n2._digit[j] + carry;
+      product[i + j + 1] = sum % 10;
+      carry = sum / 10;
+    }
+    product[i] = carry;
+  }
+
+  // the product has 2 * IntDigits integer digits, only IntDigits may be used.
+  for (uint8_t i = 0; i < IntDigits; i++) {
+    if (product[i] != 0) {
+      return false;
+    }
+  }
+
+  FIXED_DECIMAL_UNROLL
+  for (uint8_t i = 0; i < Size; i++) {
+    result._digit[i] = (i < IntDigits + prodScale) ? product[IntDigits + i] : 0;
+  }
+  result._negative = (n1._negative != n2._negative) && !result.isZero();
+  result._scale = prodScale;
+  return true;
+}
+
+/**
+   \brief result = n1 / n2, truncated to scale fraction digits like bc_divide.
+   \return false if the quotient does not fit.
+
+   Dividing by zero gives zero with no fraction digits, as BigNumber does.
+*/
+template <uint8_t Digits, uint8_t Scale>
+FIXED_DECIMAL_CONSTEXPR bool FixedDecimal<Digits, Scale>::divide(const FixedDecimal &n1, const FixedDecimal &n2, FixedDecimal &result, uint8_t scale) {
+  uint8_t quotient[Size + FracDigits] = {};
+  uint8_t remainder[Size + 1] = {};
+  uint8_t divisor[Size + 1] = {};
+  uint8_t qdigits = Size + scale;
+
+  if (scale > FracDigits) {
+    return false;
+  }
+  if (n2.isZero()) {
+    result.clear();
+    return true;
+  }
+
+  // long division of n1 followed by scale zeros; both share FracDigits.
+  FIXED_DECIMAL_UNROLL
+  for (uint8_t i = 0; i < Size; i++) {
+    divisor[i + 1] = n2._digit[i];
+  }
+  for (uint8_t i = 0; i < qdigits; i++) {
+    FIXED_DECIMAL_UNROLL
+    for (uint8_t j = 0; j < Size; j++) {
+      remainder[j] = remainder[j + 1];
+    }
+    remainder[Size] = (i < Size) ? n1._digit[i] : 0;
+    while (compare<Size + 1>(remainder, divisor) >= 0) {
+      subDigits<Size + 1>(remainder, divisor, remainder);
+      quotient[i]++;
+    }
+  }
+
+  // quotient has Size integer digits, only IntDigits may be used.
+  for (uint8_t i = 0; i < FracDigits; i++) {
+    if (quotient[i] != 0) {
+      return false;
+    }
+  }
+
+  FIXED_DECIMAL_UNROLL
+  for (uint8_t i = 0; i < Size; i++) {
+    result._digit[i] = (i < IntDigits + scale) ? quotient[FracDigits + i] : 0;
+  }
+  result._negative = (n1._negative != n2._negative) && !result.isZero();
+  result._scale = scale;
+  return true;
+}
+
+#endif
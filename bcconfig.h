@@ -10,11 +10,58 @@
 #include <limits.h>
 #define NDEBUG 1
 
-#define _zero_		bc_zero
-#define _one_		bc_one
-#define _two_		bc_two
 #define num2str		bc_num2str
-#define mul_base_digits bc_mul_base_digits
+
+/* The special numbers and the crossovers live in the current context
+   (see bc_context in number.h) instead of in globals. */
+#define _zero_		(bc_current->c_zero)
+#define _one_		(bc_current->c_one)
+#define _two_		(bc_current->c_two)
+#define mul_base_digits (bc_current->c_mul_base_digits)
+#define mul_toom3_digits (bc_current->c_mul_toom3_digits)
+#define mul_ntt_digits (bc_current->c_mul_ntt_digits)
+#define div_newton_digits (bc_current->c_div_newton_digits)
+#define div_bz_digits (bc_current->c_div_bz_digits)
+
+/* Define BC_LIMBS to run the multiply kernels on base 10^9 limbs (32 bits
+   each) instead of one decimal digit per char.  Numbers are still kept one
+   digit per char in n_value; operands are packed into limbs on the way in
+   and unpacked on the way out.  Meant for host builds on large numbers. */
+/* #define BC_LIMBS 1 */
+
+/* The add, subtract and compare kernels use SSE2 or AVX2 when the
+   compiler targets them.  Define BC_NO_SIMD to keep the scalar loops. */
+/* #define BC_NO_SIMD 1 */
+
+/* Define BC_THREADSAFE to make the reference counts atomic, so a number
+   (and a BigNumber) can be shared by threads, each working in a
+   bc_context of its own, instead of copied.  Host builds only. */
+/* #define BC_THREADSAFE 1 */
+
+/* Define BC_THREADS to let huge multiplies run their sub-products on
+   worker threads (POSIX threads), see bc_start_threads.  Host builds
+   only; without it, or on AVR, multiplies stay on the calling thread. */
+/* #define BC_THREADS 1 */
+#if defined(__AVR__)
+#undef BC_THREADS
+#endif
+
+/* The NTT multiply tier, for operands of tens of thousands of digits and
+   up, needs 64 bit arithmetic and megabytes of scratch, so it is only
+   built for hosts. */
+#if !defined(__AVR__) && !defined(BC_NO_NTT)
+#define BC_NTT 1
+#endif
+
+/* Most freed headers, and most freed digit buffers per size class, that
+   are kept for reuse instead of going back to the heap. */
+#ifndef BC_POOL_MAX
+#if defined(__AVR__)
+#define BC_POOL_MAX 8
+#else
+#define BC_POOL_MAX 64
+#endif
+#endif
 
 #define bc_rt_warn		bc_error
 #define bc_rt_error		bc_error
@@ -0,0 +1,842 @@
+/* bcmath.c: exp, ln, sin, cos, atan and the constants pi, e and ln 2
+   for the numbers of number.c. */
+
+/*
+   Each function works MATH_GUARD digits past the scale it is asked for
+   and truncates the answer to that scale.
+
+   The series are summed by binary splitting.  When the ratio of two
+   neighbouring terms is a ratio of small integers, a product tree
+   folds n terms into one fraction T / (B Q), so the sum costs about
+   log n rounds of multiplies of growing size and a single long divide
+   instead of n divides at full length.
+
+   exp, sin and cos reduce their argument below one, then cut its
+   fraction digits into pieces of 2, 2, 4, 8, 16, ... digits and
+   combine the series of each piece (the "bit-burst" method).  The
+   first piece is short, so its terms have small numerators; the later
+   pieces are small, so their series need few terms.  ln and atan are
+   Newton iterations on exp and on sin and cos, each step at about
+   twice (three times for atan) the precision of the one before.
+
+   pi, e and ln 2 are kept once computed and only computed again when a
+   larger scale is asked for.
+*/
+
+#include <stdio.h>
+#include "bcconfig.h"
+#include "number.h"
+#include "bcmath.h"
+
+/* Digits carried past the scale asked for. */
+#define MATH_GUARD 12
+
+/* Digits in the first bit-burst piece; every later piece is as long as
+   all the ones before it together. */
+#define BURST_FIRST_DIGITS 2
+
+/* Precision of the first Newton steps of ln and atan. */
+#define NEWTON_START_DIGITS 10
+
+/* The series _bc_series_sum knows.  With v = N / 10^D and m an
+   integer, they are
+     SERIES_EXP    sum v^k / k!             = exp (v)
+     SERIES_SIN    sum (-v^2)^k / (2k+1)!   = sin (v) / v
+     SERIES_COS    sum (-v^2)^k / (2k)!     = cos (v)
+     SERIES_ATAN   sum (-1)^k / ((2k+1) m^2k)  = m atan (1/m)
+     SERIES_ATANH  sum 1 / ((2k+1) m^2k)    = m atanh (1/m)  */
+#define SERIES_EXP   0
+#define SERIES_SIN   1
+#define SERIES_COS   2
+#define SERIES_ATAN  3
+#define SERIES_ATANH 4
+
+typedef struct bc_series
+{
+  int    s_kind;	/* One of the SERIES_ values. */
+  bc_num s_ratio;	/* Term k over term k-1 is s_ratio / q(k), or
+			   for the atan series s_ratio b(k-1) / (q b(k)). */
+  bc_num s_square;	/* m^2, for the atan series. */
+  int    s_shift;	/* D. */
+} bc_series;
+
+/* Constants kept between calls, in c_math of the current context. */
+#define MATH_PI  0
+#define MATH_E   1
+#define MATH_LN2 2
+
+
+/* RESULT = NUM truncated (or padded with zeros) to SCALE digits after
+   the decimal point.  Unlike bc_divide by one, never leaves a -0. */
+
+static void
+_bc_math_trunc (bc_num num, int scale, bc_num *result)
+{
+  bc_num temp;
+
+  temp = bc_new_num (num->n_len, scale);
+  memcpy (temp->n_value, num->n_value,
+          num->n_len + MIN (num->n_scale, scale));
+  temp->n_sign = (bc_is_zero (temp) ? PLUS : num->n_sign);
+  bc_free_num (result);
+  *result = temp;
+}
+
+/* The number of decimal digits in VAL. */
+
+static int
+_bc_long_digits (long val)
+{
+  int digits;
+
+  if (val < 0) val = -val;
+  for (digits = 1; val >= BASE; val /= BASE)
+    digits++;
+  return digits;
+}
+
+/* A lower bound on 1000 log10 (VAL), for VAL >= 1. */
+
+static long
+_bc_log10k (long val)
+{
+  static const int lead[BASE] = { 0, 0, 301, 477, 602, 698, 778, 845,
+                                  903, 954 };
+  long log;
+
+  for (log = 0; val >= BASE; val /= BASE)
+    log += 1000;
+  return log + lead[val];
+}
+
+/* The number of terms to sum so that the first one left out is below
+   10^-(SCALE+2), when term k is at most 10^(-GAIN k / 1000) / (FACT k)!
+   with FACT 0, 1 or 2 (and (2k)! read as a product of k pairs). */
+
+static int
+_bc_series_terms (long gain, int fact, int scale)
+{
+  long need, have;
+  int terms, index;
+
+  need = 1000L * (scale + 2);
+  have = 0;
+  for (terms = 0; have < need; )
+  {
+    terms++;
+    have += gain;
+    for (index = 0; index < fact; index++)
+      have += _bc_log10k ((long) fact * terms - index);
+  }
+  return terms;
+}
+
+/* Q = q(K), the denominator SER brings in at term K. */
+
+static void
+_bc_series_q (bc_series *ser, int k, bc_num *q)
+{
+  switch (ser->s_kind)
+  {
+    case SERIES_EXP:
+      bc_int2num (q, k);
+      bc_shift10 (*q, ser->s_shift, q);
+      break;
+    case SERIES_SIN:
+      bc_int2num (q, 2 * k);
+      bc_mul_small (*q, 2 * k + 1, q);
+      bc_shift10 (*q, 2 * ser->s_shift, q);
+      break;
+    case SERIES_COS:
+      bc_int2num (q, 2 * k - 1);
+      bc_mul_small (*q, 2 * k, q);
+      bc_shift10 (*q, 2 * ser->s_shift, q);
+      break;
+    default:
+      bc_free_num (q);
+      *q = bc_copy_num (ser->s_square);
+      break;
+  }
+}
+
+/* Binary splitting of terms A to B-1 of SER.  With p(k) the ratio,
+   q(k) from _bc_series_q and b(k) = 2k+1 for the atan series (one
+   otherwise), gives P = p(A)..p(B-1), Q = q(A)..q(B-1),
+   BB = b(A)..b(B-1) (NULL when every b is one) and
+     T = B Q sum (k = A..B-1) p(A)..p(k) / (b(k) q(A)..q(k)).
+   P is only made when NEED_P. */
+
+static void
+_bc_series_split (bc_series *ser, int a, int b, int need_p, bc_num *p,
+                  bc_num *q, bc_num *bb, bc_num *t)
+{
+  bc_num p2, q2, b2, t2;
+  int atan, mid;
+
+  atan = (ser->s_kind == SERIES_ATAN || ser->s_kind == SERIES_ATANH);
+  *p = *q = *bb = *t = NULL;
+  if (b - a == 1)
+  {
+    if (need_p) *p = bc_copy_num (ser->s_ratio);
+    _bc_series_q (ser, a, q);
+    if (atan) bc_int2num (bb, 2 * a + 1);
+    *t = bc_copy_num (ser->s_ratio);
+    return;
+  }
+
+  mid = (a + b) / 2;
+  _bc_series_split (ser, a, mid, TRUE, p, q, bb, t);
+  _bc_series_split (ser, mid, b, need_p, &p2, &q2, &b2, &t2);
+
+  /* T = B2 Q2 T1 + B1 P1 T2 */
+  bc_multiply (*t, q2, t, 0);
+  bc_multiply (*p, t2, &t2, 0);
+  if (atan)
+  {
+    bc_multiply (*t, b2, t, 0);
+    bc_multiply (t2, *bb, &t2, 0);
+    bc_multiply (*bb, b2, bb, 0);
+  }
+  bc_add (*t, t2, t, 0);
+  bc_multiply (*q, q2, q, 0);
+  if (need_p)
+    bc_multiply (*p, p2, p, 0);
+  else
+    bc_free_num (p);
+
+  bc_free_num (&p2);
+  bc_free_num (&q2);
+  bc_free_num (&b2);
+  bc_free_num (&t2);
+}
+
+/* SUM = the first TERMS terms of SER, to SCALE digits. */
+
+static void
+_bc_series_sum (bc_series *ser, int terms, bc_num *sum, int scale)
+{
+  bc_num p, q, bb, t;
+
+  if (terms <= 1)
+  {
+    bc_free_num (sum);
+    *sum = bc_copy_num (_one_);
+    return;
+  }
+
+  _bc_series_split (ser, 1, terms, FALSE, &p, &q, &bb, &t);
+  if (bb != NULL)
+    bc_multiply (q, bb, &q, 0);
+  bc_divide (t, q, sum, scale);
+  bc_add (*sum, _one_, sum, 0);
+
+  bc_free_num (&q);
+  bc_free_num (&bb);
+  bc_free_num (&t);
+}
+
+/* The digits LOW+1 to HIGH after the decimal point of NUM as an
+   integer with the sign of NUM, or NULL if they are all zero. */
+
+static bc_num
+_bc_burst_piece (bc_num num, int low, int high)
+{
+  bc_num piece;
+  char *src;
+  int len;
+
+  src = num->n_value + num->n_len + low;
+  for (len = high - low; len > 0 && *src == 0; len--)
+    src++;
+  if (len == 0) return NULL;
+
+  piece = bc_new_num (len, 0);
+  memcpy (piece->n_value, src, len);
+  piece->n_sign = num->n_sign;
+  return piece;
+}
+
+/* RESULT = exp (NUM) to SCALE digits, for |NUM| < 1. */
+
+static void
+_bc_exp_small (bc_num num, bc_num *result, int scale)
+{
+  bc_series ser;
+  bc_num value, piece, sum;
+  int digits, low, high;
+
+  value = bc_copy_num (_one_);
+  bc_init_num (&sum);
+  digits = MIN (num->n_scale, scale);
+
+  for (low = 0, high = BURST_FIRST_DIGITS; low < digits;
+       low = high, high *= 2)
+  {
+    high = MIN (high, digits);
+    piece = _bc_burst_piece (num, low, high);
+    if (piece == NULL) continue;
+
+    /* exp (N / 10^high), with N / 10^high below 10^-low. */
+    ser.s_kind = SERIES_EXP;
+    ser.s_ratio = piece;
+    ser.s_square = NULL;
+    ser.s_shift = high;
+    _bc_series_sum (&ser, _bc_series_terms (1000L * low, 1, scale), &sum,
+                    scale);
+    bc_multiply (value, sum, &value, scale);
+    bc_free_num (&piece);
+  }
+  bc_free_num (&sum);
+  bc_free_num (result);
+  *result = value;
+}
+
+/* SIN = sin (NUM) and COS = cos (NUM) to SCALE digits, for |NUM| < 1. */
+
+static void
+_bc_sincos_small (bc_num num, bc_num *sin, bc_num *cos, int scale)
+{
+  bc_series ser;
+  bc_num sval, cval, piece, s, c, t1, t2;
+  int digits, low, high;
+
+  sval = bc_copy_num (_zero_);
+  cval = bc_copy_num (_one_);
+  bc_init_num (&s);
+  bc_init_num (&c);
+  bc_init_num (&t1);
+  bc_init_num (&t2);
+  digits = MIN (num->n_scale, scale);
+
+  for (low = 0, high = BURST_FIRST_DIGITS; low < digits;
+       low = high, high *= 2)
+  {
+    high = MIN (high, digits);
+    piece = _bc_burst_piece (num, low, high);
+    if (piece == NULL) continue;
+
+    /* s and c of v = N / 10^high. */
+    ser.s_kind = SERIES_SIN;
+    ser.s_ratio = NULL;
+    bc_square (piece, &ser.s_ratio, 0);
+    bc_sub (_zero_, ser.s_ratio, &ser.s_ratio, 0);
+    ser.s_square = NULL;
+    ser.s_shift = high;
+    _bc_series_sum (&ser, _bc_series_terms (2000L * low, 2, scale), &s,
+                    scale);
+    bc_multiply (s, piece, &s, scale);
+    bc_shift10 (s, -high, &s);
+    _bc_math_trunc (s, scale, &s);
+    ser.s_kind = SERIES_COS;
+    _bc_series_sum (&ser, _bc_series_terms (2000L * low, 2, scale), &c,
+                    scale);
+    bc_free_num (&ser.s_ratio);
+    bc_free_num (&piece);
+
+    /* The angle sum: sin (x+v) = sin x cos v + cos x sin v,
+       cos (x+v) = cos x cos v - sin x sin v. */
+    bc_multiply (sval, c, &t1, scale);
+    bc_multiply (cval, s, &t2, scale);
+    bc_multiply (cval, c, &cval, scale);
+    bc_multiply (sval, s, &sval, scale);
+    bc_sub (cval, sval, &cval, scale);
+    bc_add (t1, t2, &sval, scale);
+  }
+
+  bc_free_num (&s);
+  bc_free_num (&c);
+  bc_free_num (&t1);
+  bc_free_num (&t2);
+  bc_free_num (sin);
+  bc_free_num (cos);
+  *sin = sval;
+  *cos = cval;
+}
+
+/* RESULT = the sum of SERIES_ATAN or SERIES_ATANH (KIND) for M, divided
+   by M: atan (1/M) or atanh (1/M), to SCALE digits. */
+
+static void
+_bc_atan_inv (int kind, int m, bc_num *result, int scale)
+{
+  bc_series ser;
+
+  ser.s_kind = kind;
+  ser.s_ratio = NULL;
+  ser.s_square = NULL;
+  ser.s_shift = 0;
+  bc_int2num (&ser.s_ratio, kind == SERIES_ATAN ? -1 : 1);
+  bc_int2num (&ser.s_square, m);
+  bc_mul_small (ser.s_square, m, &ser.s_square);
+  _bc_series_sum (&ser, _bc_series_terms (2 * _bc_log10k (m), 0, scale),
+                  result, scale);
+  (void) bc_div_small (*result, m, result, NULL, scale);
+  bc_free_num (&ser.s_ratio);
+  bc_free_num (&ser.s_square);
+}
+
+/* pi = 16 atan (1/5) - 4 atan (1/239) (Machin). */
+
+static void
+_bc_compute_pi (bc_num *result, int scale)
+{
+  bc_num temp;
+
+  bc_init_num (&temp);
+  _bc_atan_inv (SERIES_ATAN, 5, result, scale + MATH_GUARD);
+  bc_mul_small (*result, 16, result);
+  _bc_atan_inv (SERIES_ATAN, 239, &temp, scale + MATH_GUARD);
+  bc_mul_small (temp, 4, &temp);
+  bc_sub (*result, temp, result, 0);
+  _bc_math_trunc (*result, scale, result);
+  bc_free_num (&temp);
+}
+
+/* e = sum 1 / k! */
+
+static void
+_bc_compute_e (bc_num *result, int scale)
+{
+  bc_series ser;
+
+  ser.s_kind = SERIES_EXP;
+  ser.s_ratio = bc_copy_num (_one_);
+  ser.s_square = NULL;
+  ser.s_shift = 0;
+  _bc_series_sum (&ser, _bc_series_terms (0, 1, scale + MATH_GUARD),
+                  result, scale + MATH_GUARD);
+  _bc_math_trunc (*result, scale, result);
+  bc_free_num (&ser.s_ratio);
+}
+
+/* ln 2 = 18 atanh (1/26) - 2 atanh (1/4801) + 8 atanh (1/8749). */
+
+static void
+_bc_compute_ln2 (bc_num *result, int scale)
+{
+  bc_num temp;
+
+  bc_init_num (&temp);
+  _bc_atan_inv (SERIES_ATANH, 26, result, scale + MATH_GUARD);
+  bc_mul_small (*result, 18, result);
+  _bc_atan_inv (SERIES_ATANH, 4801, &temp, scale + MATH_GUARD);
+  bc_mul_small (temp, 2, &temp);
+  bc_sub (*result, temp, result, 0);
+  _bc_atan_inv (SERIES_ATANH, 8749, &temp, scale + MATH_GUARD);
+  bc_mul_small (temp, 8, &temp);
+  bc_add (*result, temp, result, 0);
+  _bc_math_trunc (*result, scale, result);
+  bc_free_num (&temp);
+}
+
+/* RESULT = constant WHICH to SCALE digits, filling its cache by
+   COMPUTE first if it does not hold that many.  At the scale it was
+   computed to, the cached number itself is handed out. */
+
+static void
+_bc_cached (int which, void (*compute) (bc_num *, int),
+            bc_num *result, int scale)
+{
+  bc_context *ctx = bc_current;
+
+  if (ctx->c_math[which] == NULL || ctx->c_math_scale[which] < scale)
+  {
+    bc_free_num (&ctx->c_math[which]);
+    compute (&ctx->c_math[which], scale);
+    ctx->c_math_scale[which] = scale;
+  }
+  if (ctx->c_math[which]->n_scale == scale)
+  {
+    bc_free_num (result);
+    *result = bc_copy_num (ctx->c_math[which]);
+  }
+  else
+    _bc_math_trunc (ctx->c_math[which], scale, result);
+}
+
+void bc_pi (bc_num *result, int scale)
+{
+  _bc_cached (MATH_PI, _bc_compute_pi, result, scale);
+}
+
+void bc_e (bc_num *result, int scale)
+{
+  _bc_cached (MATH_E, _bc_compute_e, result, scale);
+}
+
+void bc_ln2 (bc_num *result, int scale)
+{
+  _bc_cached (MATH_LN2, _bc_compute_ln2, result, scale);
+}
+
+/* Frees the cached constants of the current context. */
+
+void bc_free_math_constants (void)
+{
+  int which;
+
+  for (which = 0; which < BC_MATH_CONSTS; which++)
+    bc_free_num (&bc_current->c_math[which]);
+}
+
+/* RESULT = exp (NUM) to SCALE digits.  NUM = k ln 2 + r with |r| < 1,
+   and 2^k is exact (as 5^-k / 10^-k for negative k).  Returns -1,
+   doing nothing, if the answer would not fit in memory anyway. */
+
+int bc_exp (bc_num num, bc_num *result, int scale)
+{
+  bc_num ln2, k, power, r;
+  long kval, int_digits;
+  int prec, ln2_scale;
+
+  if (num->n_len > 9)
+  {
+    if (num->n_sign == PLUS) return -1;
+    _bc_math_trunc (_zero_, scale, result);
+    return 0;
+  }
+
+  /* k = NUM / ln 2, truncated; a rough ln 2 does for that. */
+  bc_init_num (&ln2);
+  bc_init_num (&k);
+  bc_ln2 (&ln2, num->n_len + MATH_GUARD);
+  bc_divide (num, ln2, &k, 0);
+  kval = bc_num2long (k);
+
+  /* 2^k below 10^-(SCALE+2) leaves nothing to show. */
+  if (kval < 0 && -kval > (scale + 2) * 10L / 3 + 10)
+  {
+    bc_free_num (&ln2);
+    bc_free_num (&k);
+    _bc_math_trunc (_zero_, scale, result);
+    return 0;
+  }
+
+  /* exp (r) is needed to as many digits as 2^k has, past SCALE. */
+  int_digits = (kval > 0 ? kval / 100000 * 30103
+                           + kval % 100000 * 30103 / 100000 + 2 : 0);
+  if (int_digits > INT_MAX / 2 - scale - 2 * MATH_GUARD)
+  {
+    bc_free_num (&ln2);
+    bc_free_num (&k);
+    return -1;
+  }
+  prec = scale + (int) int_digits + MATH_GUARD;
+  ln2_scale = prec + _bc_long_digits (kval) + 1;
+
+  /* r = NUM - k ln 2 */
+  bc_init_num (&power);
+  bc_init_num (&r);
+  bc_ln2 (&ln2, ln2_scale);
+  bc_multiply (k, ln2, &r, ln2_scale);
+  bc_sub (num, r, &r, ln2_scale);
+  _bc_math_trunc (r, prec, &r);
+  _bc_exp_small (r, &r, prec);
+
+  if (kval >= 0)
+  {
+    bc_raise (_two_, k, &power, 0);
+    bc_multiply (r, power, &r, prec);
+  }
+  else
+  {
+    bc_int2num (&power, 5);
+    k->n_sign = PLUS;
+    bc_raise (power, k, &power, 0);
+    bc_multiply (r, power, &r, prec);
+    bc_shift10 (r, (int) kval, &r);
+  }
+  _bc_math_trunc (r, scale, result);
+
+  bc_free_num (&ln2);
+  bc_free_num (&k);
+  bc_free_num (&power);
+  bc_free_num (&r);
+  return 0;
+}
+
+
+/* The number NUM made from VAL. */
+
+static void
+_bc_long2num (bc_num *num, long val)
+{
+  char buffer[24];
+
+  sprintf (buffer, "%ld", val);
+  bc_str2num (num, buffer, 0);
+}
+
+/* Precisions for Newton steps that multiply the good digits by GROWTH
+   (2 or 3) up to PREC, last first, with three steps at
+   NEWTON_START_DIGITS at the end.  Returns how many. */
+
+static int
+_bc_newton_precs (int prec, int growth, int *precs)
+{
+  int steps;
+
+  for (steps = 0; prec > NEWTON_START_DIGITS; prec = prec / growth + 3)
+    precs[steps++] = prec;
+  precs[steps++] = NEWTON_START_DIGITS;
+  precs[steps++] = NEWTON_START_DIGITS;
+  precs[steps++] = NEWTON_START_DIGITS;
+  return steps;
+}
+
+/* RESULT = ln (NUM) to SCALE digits.  NUM = m 2^k with m near one, and
+   y = ln m comes from Newton's method on exp: y += m exp (-y) - 1.
+   Returns -1, doing nothing, if NUM is not above zero. */
+
+int bc_ln (bc_num num, bc_num *result, int scale)
+{
+  bc_num m, y, e, k, power, limit, ln2;
+  char *nptr;
+  int exp10, prec, precs[40], steps;
+  long kval;
+
+  if (num->n_sign == MINUS || bc_is_zero (num)) return -1;
+
+  /* NUM is below 10^exp10 and at least a tenth of that, so k starts
+     near exp10 log2 (10). */
+  if (num->n_len > 1 || num->n_value[0] != 0)
+    exp10 = num->n_len;
+  else
+  {
+    exp10 = 0;
+    for (nptr = num->n_value + 1; *nptr == 0; nptr++)
+      exp10--;
+  }
+  kval = (long) exp10 * 33219L / 10000L;
+
+  /* m = NUM / 2^k, exactly. */
+  bc_init_num (&m);
+  bc_init_num (&k);
+  bc_init_num (&power);
+  _bc_long2num (&k, kval < 0 ? -kval : kval);
+  if (kval > 0)
+  {
+    bc_int2num (&power, 5);
+    bc_raise (power, k, &power, 0);
+    bc_multiply (num, power, &m, 0);
+    bc_shift10 (m, (int) -kval, &m);
+  }
+  else
+  {
+    bc_raise (_two_, k, &power, 0);
+    bc_multiply (num, power, &m, 0);
+  }
+
+  /* Halve or double m into [0.75, 1.5), where |ln m - (m - 1)| < 0.1. */
+  bc_init_num (&limit);
+  bc_str2num (&limit, "1.5", 1);
+  while (bc_compare (m, limit) >= 0)
+  {
+    bc_mul_small (m, 5, &m);
+    bc_shift10 (m, -1, &m);
+    kval++;
+  }
+  bc_str2num (&limit, ".75", 2);
+  while (bc_compare (m, limit) < 0)
+  {
+    bc_mul_small (m, 2, &m);
+    kval--;
+  }
+  prec = scale + MATH_GUARD + _bc_long_digits (kval);
+  _bc_math_trunc (m, prec, &m);
+
+  bc_init_num (&y);
+  bc_init_num (&e);
+  bc_sub (m, _one_, &y, 0);
+  _bc_math_trunc (y, NEWTON_START_DIGITS, &y);
+  steps = _bc_newton_precs (prec, 2, precs);
+  while (steps-- > 0)
+  {
+    bc_sub (_zero_, y, &e, 0);
+    _bc_exp_small (e, &e, precs[steps]);
+    bc_multiply (m, e, &e, precs[steps]);
+    bc_add (y, e, &y, 0);
+    bc_sub (y, _one_, &y, 0);
+    _bc_math_trunc (y, precs[steps], &y);
+  }
+
+  /* ln NUM = y + k ln 2 */
+  if (kval != 0)
+  {
+    bc_init_num (&ln2);
+    bc_ln2 (&ln2, prec + _bc_long_digits (kval));
+    _bc_long2num (&k, kval);
+    bc_multiply (k, ln2, &e, prec);
+    bc_add (y, e, &y, 0);
+    bc_free_num (&ln2);
+  }
+  _bc_math_trunc (y, scale, result);
+
+  bc_free_num (&m);
+  bc_free_num (&y);
+  bc_free_num (&e);
+  bc_free_num (&k);
+  bc_free_num (&power);
+  bc_free_num (&limit);
+  return 0;
+}
+
+/* R = NUM - q pi/2 with q the nearest integer to NUM / (pi/2), to PREC
+   digits, and QUADRANT = q mod 4. */
+
+static void
+_bc_reduce_half_pi (bc_num num, bc_num *r, int *quadrant, int prec)
+{
+  bc_num half_pi, q, half;
+  int qmod;
+
+  /* q, rounded half away from zero. */
+  bc_init_num (&half_pi);
+  bc_init_num (&q);
+  bc_init_num (&half);
+  bc_pi (&half_pi, num->n_len + MATH_GUARD);
+  (void) bc_div_small (half_pi, 2, &half_pi, NULL, num->n_len + MATH_GUARD);
+  bc_divide (num, half_pi, &q, 1);
+  bc_str2num (&half, ".5", 1);
+  half->n_sign = q->n_sign;
+  bc_add (q, half, &q, 0);
+  _bc_math_trunc (q, 0, &q);
+
+  qmod = q->n_value[q->n_len - 1];
+  if (q->n_len > 1) qmod += 10 * q->n_value[q->n_len - 2];
+  qmod %= 4;
+  if (q->n_sign == MINUS) qmod = (4 - qmod) % 4;
+  *quadrant = qmod;
+
+  /* pi/2 to as many more digits as q has. */
+  bc_pi (&half_pi, prec + q->n_len + 1);
+  (void) bc_div_small (half_pi, 2, &half_pi, NULL, prec + q->n_len + 1);
+  bc_multiply (q, half_pi, &q, prec + q->n_len + 1);
+  bc_sub (num, q, r, 0);
+  _bc_math_trunc (*r, prec, r);
+
+  bc_free_num (&half_pi);
+  bc_free_num (&q);
+  bc_free_num (&half);
+}
+
+/* SIN = sin (NUM), COS = cos (NUM) to SCALE digits, either may be NULL. */
+
+static void
+_bc_sincos (bc_num num, bc_num *sin, bc_num *cos, int scale)
+{
+  bc_num r, s, c;
+  int quadrant, prec;
+
+  prec = scale + MATH_GUARD;
+  bc_init_num (&r);
+  bc_init_num (&s);
+  bc_init_num (&c);
+  _bc_reduce_half_pi (num, &r, &quadrant, prec);
+  _bc_sincos_small (r, &s, &c, prec);
+
+  /* sin (r + q pi/2) and cos (r + q pi/2) */
+  if (quadrant & 1)
+  {
+    bc_free_num (&r);
+    r = s;
+    s = c;
+    c = r;
+    r = NULL;
+    bc_sub (_zero_, c, &c, 0);
+  }
+  if (quadrant & 2)
+  {
+    bc_sub (_zero_, s, &s, 0);
+    bc_sub (_zero_, c, &c, 0);
+  }
+  if (sin != NULL) _bc_math_trunc (s, scale, sin);
+  if (cos != NULL) _bc_math_trunc (c, scale, cos);
+
+  bc_free_num (&r);
+  bc_free_num (&s);
+  bc_free_num (&c);
+}
+
+/* RESULT = sin (NUM) to SCALE digits, NUM in radians. */
+
+void bc_sin (bc_num num, bc_num *result, int scale)
+{
+  _bc_sincos (num, result, NULL, scale);
+}
+
+/* RESULT = cos (NUM) to SCALE digits, NUM in radians. */
+
+void bc_cos (bc_num num, bc_num *result, int scale)
+{
+  _bc_sincos (num, NULL, result, scale);
+}
+
+/* RESULT = atan (NUM) to SCALE digits.  Above one, atan (x) is
+   pi/2 - atan (1/x); up to one, y = atan (x) comes from Newton's method
+   on sin and cos: y += (x cos y - sin y) / (cos y + x sin y), which
+   is tan (atan (x) - y) and so triples the good digits each step. */
+
+void bc_atan (bc_num num, bc_num *result, int scale)
+{
+  bc_num x, y, s, c, t1, t2;
+  int prec, precs[40], steps, invert, negative;
+
+  prec = scale + MATH_GUARD;
+  negative = (num->n_sign == MINUS);
+  bc_init_num (&x);
+  _bc_math_trunc (num, num->n_scale, &x);
+  x->n_sign = PLUS;
+  invert = (bc_compare (x, _one_) > 0);
+  if (invert)
+    bc_divide (_one_, x, &x, prec);
+
+  /* |atan (x) - y| < 0.07 */
+  bc_init_num (&y);
+  bc_init_num (&t1);
+  bc_str2num (&t1, ".5", 1);
+  if (bc_compare (x, t1) >= 0)
+  {
+    bc_mul_small (x, 8, &y);
+    bc_shift10 (y, -1, &y);
+  }
+  else
+  {
+    bc_free_num (&y);
+    y = bc_copy_num (x);
+  }
+  _bc_math_trunc (y, NEWTON_START_DIGITS, &y);
+
+  bc_init_num (&s);
+  bc_init_num (&c);
+  bc_init_num (&t2);
+  steps = _bc_newton_precs (prec, 3, precs);
+  while (steps-- > 0)
+  {
+    _bc_sincos_small (y, &s, &c, precs[steps]);
+    bc_multiply (x, c, &t1, precs[steps]);
+    bc_sub (t1, s, &t1, 0);
+    bc_multiply (x, s, &t2, precs[steps]);
+    bc_add (t2, c, &t2, 0);
+    bc_divide (t1, t2, &t1, precs[steps]);
+    bc_add (y, t1, &y, 0);
+    _bc_math_trunc (y, precs[steps], &y);
+  }
+
+  if (invert)
+  {
+    bc_pi (&t1, prec);
+    (void) bc_div_small (t1, 2, &t1, NULL, prec);
+    bc_sub (t1, y, &y, 0);
+  }
+  if (negative)
+    bc_sub (_zero_, y, &y, 0);
+  _bc_math_trunc (y, scale, result);
+
+  bc_free_num (&x);
+  bc_free_num (&y);
+  bc_free_num (&s);
+  bc_free_num (&c);
+  bc_free_num (&t1);
+  bc_free_num (&t2);
+}
@@ -0,0 +1,25 @@
+/* bcmath.h: exp, ln, sin, cos, atan, pi, e and ln 2 for bc numbers. */
+
+#ifndef _BCMATH_H_
+#define _BCMATH_H_
+
+#include "number.h"
+
+/* Every result is truncated to the SCALE asked for.  The last digit
+   can be one off when the exact answer is within about 10^-(SCALE+10)
+   of a multiple of 10^-SCALE, as sin (x) is for tiny x.  pi, e and
+   ln 2 are kept in the current context, computed once and computed
+   again only for a larger scale; bc_free_math_constants (or
+   bc_free_context) frees them. */
+
+_PROTOTYPE(int bc_exp, (bc_num num, bc_num *result, int scale));
+_PROTOTYPE(int bc_ln, (bc_num num, bc_num *result, int scale));
+_PROTOTYPE(void bc_sin, (bc_num num, bc_num *result, int scale));
+_PROTOTYPE(void bc_cos, (bc_num num, bc_num *result, int scale));
+_PROTOTYPE(void bc_atan, (bc_num num, bc_num *result, int scale));
+_PROTOTYPE(void bc_pi, (bc_num *result, int scale));
+_PROTOTYPE(void bc_e, (bc_num *result, int scale));
+_PROTOTYPE(void bc_ln2, (bc_num *result, int scale));
+_PROTOTYPE(void bc_free_math_constants, (void));
+
+#endif
@@ -39,12 +39,108 @@
 #include "number.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <ctype.h>/* Prototypes needed for external utility routines. */
+#if defined(BC_THREADS)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* Allocation pools.  A number is one block: the header followed by its
+   digits, which start at n_inline.  Blocks come in size classes holding
+   BC_INLINE_DIGITS << c digits; class 0 is a bare header, whose inline
+   digits are enough for most values, and it is also what sub-numbers
+   (n_ptr == NULL) use.  Freed blocks are kept on one list per class,
+   linked through n_next.  Reusing blocks keeps the keypress path away
+   from malloc and stops the small AVR heap from fragmenting into pieces
+   too small for the next number.  The lists belong to the current
+   context, so threads working in contexts of their own never touch the
+   same list. */
+
+#define POOL_CLASSES BC_POOL_CLASSES
+#define BLOCK_SIZE(digits) (sizeof(bc_struct) - BC_INLINE_DIGITS + (digits))
+
+/* Return the size class that holds SIZE digits, or -1 if none does. */
+
+static int _bc_size_class (int size)
+{
+  int sclass, digits;
+
+  for (sclass = 0, digits = BC_INLINE_DIGITS; sclass < POOL_CLASSES;
+       sclass++, digits <<= 1)
+    if (size <= digits)
+      return sclass;
+  return -1;
+}
+
+/* Get a block with room for at least SIZE digits.  n_alloc is set to
+   the digit capacity and n_ptr to the digits. */
+
+static bc_num _bc_new_block (int size)
+{
+  bc_context *ctx = bc_current;
+  bc_num temp;
+  int sclass, alloc;
+
+  sclass = _bc_size_class (size);
+  if (sclass >= 0 && ctx->c_pool[sclass] != NULL)
+  {
+    temp = ctx->c_pool[sclass];
+    ctx->c_pool[sclass] = temp->n_next;
+    ctx->c_pool_count[sclass]--;
+    ctx->c_pool_hits++;
+  }
+  else
+  {
+    alloc = (sclass < 0 ? size : BC_INLINE_DIGITS << sclass);
+    temp = (bc_num) malloc (BLOCK_SIZE (alloc));
+    if (temp == NULL) bc_out_of_memory ();
+    temp->n_alloc = alloc;
+    ctx->c_pool_misses++;
+  }
+  temp->n_next = NULL;
+  temp->n_ptr = temp->n_inline;
+  return temp;
+}
+
+/* Give back a block, keeping it for reuse if its class has room. */
+
+static void _bc_free_block (bc_num num)
+{
+  bc_context *ctx = bc_current;
+  int sclass;
+
+  sclass = _bc_size_class (num->n_alloc);
+  if (sclass >= 0 && (BC_INLINE_DIGITS << sclass) == num->n_alloc
+      && ctx->c_pool_count[sclass] < BC_POOL_MAX)
+  {
+    num->n_next = ctx->c_pool[sclass];
+    ctx->c_pool[sclass] = num;
+    ctx->c_pool_count[sclass]++;
+  }
+  else
+    free (num);
+}
 
-/* Storage used for special numbers. */
-bc_num _zero_;
-bc_num _one_;
-bc_num _two_;
+/* Reference counts.  Once a number can be shared (bc_copy_num) it is
+   never changed; the routines only write to numbers they have just
+   made.  So with BC_THREADSAFE, where the counts are atomic, threads
+   can share numbers without copying the digits.  A count of 1 means
+   nobody else holds the number, so freeing it needs no atomic
+   operation; most numbers are temporaries that are never shared. */
+
+#if defined(BC_THREADSAFE)
+#if !defined(__GNUC__)
+#error "BC_THREADSAFE needs the GCC __atomic builtins"
+#endif
+#define REF_ADD(num)  __atomic_add_fetch (&(num)->n_refs, 1, __ATOMIC_RELAXED)
+#define REF_LAST(num) \
+  (__atomic_load_n (&(num)->n_refs, __ATOMIC_ACQUIRE) == 1 \
+   || __atomic_sub_fetch (&(num)->n_refs, 1, __ATOMIC_ACQ_REL) == 0)
+#else
+#define REF_ADD(num)  ((num)->n_refs++)
+#define REF_LAST(num) (--(num)->n_refs == 0)
+#endif
 
 /* new_num allocates a number and sets fields to known values. */
 
@@ -52,39 +148,70 @@ bc_num bc_new_num (int length, int scale)
 {
   bc_num temp;
 
-  temp = (bc_num) malloc (sizeof(bc_struct));
-  if (temp == NULL) bc_out_of_memory ();
+  temp = _bc_new_block (length + scale);
   temp->n_sign = PLUS;
   temp->n_len = length;
   temp->n_scale = scale;
   temp->n_refs = 1;
-  temp->n_ptr = (char *) malloc (length + scale);
-  if (temp->n_ptr == NULL) bc_out_of_memory();
   temp->n_value = temp->n_ptr;
   memset (temp->n_ptr, 0, length + scale);
   return temp;
 }
 
 /* "Frees" a bc_num NUM.  Actually decreases reference count and only
-   frees the storage if reference count is zero. */
+   frees the storage if reference count is zero.  The storage goes to
+   the pools of the current context, whichever context made it. */
 
 void bc_free_num (bc_num *num)
 {
   if (*num == NULL) return;
-  (*num)->n_refs--;
-  if ((*num)->n_refs == 0) {
-    if ((*num)->n_ptr)
-      free ((*num)->n_ptr);
-    free (*num);
-  }
+  if (REF_LAST (*num))
+    _bc_free_block (*num);
   *num = NULL;
 }
 
+/* Report how the pools are doing. */
+
+void bc_pool_stats (bc_pool_stat *stats)
+{
+  bc_context *ctx = bc_current;
+  int sclass;
+
+  stats->hits = ctx->c_pool_hits;
+  stats->misses = ctx->c_pool_misses;
+  stats->cached = 0;
+  for (sclass = 0; sclass < POOL_CLASSES; sclass++)
+    stats->cached += ctx->c_pool_count[sclass];
+}
+
+/* Hand every cached block back to the heap. */
+
+void bc_pool_trim (void)
+{
+  bc_context *ctx = bc_current;
+  bc_num temp;
+  int sclass;
+
+  for (sclass = 0; sclass < POOL_CLASSES; sclass++)
+  {
+    while (ctx->c_pool[sclass] != NULL)
+    {
+      temp = ctx->c_pool[sclass];
+      ctx->c_pool[sclass] = temp->n_next;
+      free (temp);
+    }
+    ctx->c_pool_count[sclass] = 0;
+  }
+}
+
 
-/* Intitialize the number package! */
+/* Intitialize the number package!  This sets up the current context,
+   the package's own unless bc_use_context chose another, and does
+   nothing if it is set up already. */
 
 void bc_init_numbers ()
 {
+  if (_zero_ != NULL) return;
   _zero_ = bc_new_num (1, 0);
   _one_  = bc_new_num (1, 0);
   _one_->n_value[0] = 1;
@@ -97,7 +224,7 @@ void bc_init_numbers ()
 
 bc_num bc_copy_num (bc_num num)
 {
-  num->n_refs++;
+  REF_ADD (num);
   return num;
 }
 
@@ -122,6 +249,234 @@ static void _bc_rm_leading_zeros (bc_num num)
   }
 }
 
+/* Digit kernels.  The add, subtract and compare loops below work on runs
+   of digits of equal length.  On x86-64 hosts they take 16 (SSE2) or 32
+   (AVX2) digits per step: the digits are added or subtracted bytewise,
+   and the carries are then resolved for the whole step at once.  A digit
+   generates a carry if its sum is over 9 (a borrow if its difference is
+   below 0) and propagates an incoming one if it is exactly 9 (exactly 0).
+   With the generate and propagate bits in masks G and P, least
+   significant digit in bit 0, the carries into each digit are
+   (((G << 1) | carry_in) + P) ^ P; the integer add does the rippling.
+   Digits are stored most significant first, so the masks from movemask
+   are bit reversed before and after.  AVR builds get the scalar loops. */
+
+#if !defined(BC_NO_SIMD) && (defined(__SSE2__) || defined(__AVX2__))
+#include <immintrin.h>
+
+static uint32_t _bc_bit_reverse (uint32_t x, int bits)
+{
+  x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+  x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+  x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+  x = (x >> 16) | (x << 16);
+  return x >> (32 - bits);
+}
+
+/* Carries into each digit of a STEP digit run, in memory order, from
+   the generate and propagate masks GEN and PROP as made by movemask.
+   *CARRY is the carry into the last digit, and is replaced by the carry
+   out of the first. */
+
+static uint32_t _bc_resolve_carries (uint32_t gen, uint32_t prop, int step,
+                                     int *carry)
+{
+  uint64_t g, p, c;
+
+  g = _bc_bit_reverse (gen, step);
+  p = _bc_bit_reverse (prop, step);
+  c = (((g << 1) | *carry) + p) ^ p;
+  *carry = (int) (c >> step) & 1;
+  return _bc_bit_reverse ((uint32_t) c, step);
+}
+
+/* Turn the low 16 bits of MASK into bytes of 0xFF (bit set) or 0. */
+
+static __m128i _bc_expand_mask16 (uint32_t mask)
+{
+  const __m128i bits = _mm_setr_epi8 (1, 2, 4, 8, 16, 32, 64, -128,
+                                      1, 2, 4, 8, 16, 32, 64, -128);
+  __m128i v;
+
+  v = _mm_cvtsi32_si128 ((int) mask);
+  v = _mm_unpacklo_epi8 (v, v);
+  v = _mm_unpacklo_epi16 (v, v);
+  v = _mm_unpacklo_epi32 (v, v);
+  return _mm_cmpeq_epi8 (_mm_and_si128 (v, bits), bits);
+}
+
+#if defined(__AVX2__)
+/* Turn the 32 bits of MASK into bytes of 0xFF (bit set) or 0. */
+
+static __m256i _bc_expand_mask32 (uint32_t mask)
+{
+  const __m256i select = _mm256_setr_epi8 (0, 0, 0, 0, 0, 0, 0, 0,
+                                           1, 1, 1, 1, 1, 1, 1, 1,
+                                           2, 2, 2, 2, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 3, 3, 3, 3);
+  const __m256i bits = _mm256_set1_epi64x ((long long) 0x8040201008040201ULL);
+  __m256i v;
+
+  v = _mm256_shuffle_epi8 (_mm256_set1_epi32 ((int) mask), select);
+  return _mm256_cmpeq_epi8 (_mm256_and_si256 (v, bits), bits);
+}
+#endif
+#define BC_SIMD 1
+#endif
+
+/* Add the COUNT digits at N1PTR and N2PTR into SUMPTR with CARRY into
+   the last digit.  SUMPTR may be N1PTR.  Returns the carry out of the
+   first digit. */
+
+static int _bc_add_digits (char *sumptr, const char *n1ptr,
+                           const char *n2ptr, int count, int carry)
+{
+  int sum;
+
+#if defined(BC_SIMD)
+#if defined(__AVX2__)
+  while (count >= 32)
+  {
+    const __m256i nine = _mm256_set1_epi8 (BASE - 1);
+    const __m256i ten = _mm256_set1_epi8 (BASE);
+    __m256i digits, fix;
+    uint32_t gen, prop, carries;
+
+    count -= 32;
+    digits = _mm256_add_epi8 (
+               _mm256_loadu_si256 ((const __m256i *) (n1ptr + count)),
+               _mm256_loadu_si256 ((const __m256i *) (n2ptr + count)));
+    gen = _mm256_movemask_epi8 (_mm256_cmpgt_epi8 (digits, nine));
+    prop = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (digits, nine));
+    carries = _bc_resolve_carries (gen, prop, 32, &carry);
+    digits = _mm256_sub_epi8 (digits, _bc_expand_mask32 (carries));
+    fix = _mm256_and_si256 (_mm256_cmpgt_epi8 (digits, nine), ten);
+    _mm256_storeu_si256 ((__m256i *) (sumptr + count),
+                         _mm256_sub_epi8 (digits, fix));
+  }
+#endif
+  while (count >= 16)
+  {
+    const __m128i nine = _mm_set1_epi8 (BASE - 1);
+    const __m128i ten = _mm_set1_epi8 (BASE);
+    __m128i digits, fix;
+    uint32_t gen, prop, carries;
+
+    count -= 16;
+    digits = _mm_add_epi8 (_mm_loadu_si128 ((const __m128i *) (n1ptr + count)),
+                           _mm_loadu_si128 ((const __m128i *) (n2ptr + count)));
+    gen = _mm_movemask_epi8 (_mm_cmpgt_epi8 (digits, nine));
+    prop = _mm_movemask_epi8 (_mm_cmpeq_epi8 (digits, nine));
+    carries = _bc_resolve_carries (gen, prop, 16, &carry);
+    digits = _mm_sub_epi8 (digits, _bc_expand_mask16 (carries));
+    fix = _mm_and_si128 (_mm_cmpgt_epi8 (digits, nine), ten);
+    _mm_storeu_si128 ((__m128i *) (sumptr + count), _mm_sub_epi8 (digits, fix));
+  }
+#endif
+  while (count-- > 0)
+  {
+    sum = n1ptr[count] + n2ptr[count] + carry;
+    carry = (sum > BASE - 1);
+    sumptr[count] = (carry ? sum - BASE : sum);
+  }
+  return carry;
+}
+
+/* Subtract the COUNT digits at N2PTR from those at N1PTR into DIFFPTR
+   with BORROW from the last digit.  DIFFPTR may be N1PTR.  Returns the
+   borrow from the first digit. */
+
+static int _bc_sub_digits (char *diffptr, const char *n1ptr,
+                           const char *n2ptr, int count, int borrow)
+{
+  int val;
+
+#if defined(BC_SIMD)
+#if defined(__AVX2__)
+  while (count >= 32)
+  {
+    const __m256i zero = _mm256_setzero_si256 ();
+    const __m256i ten = _mm256_set1_epi8 (BASE);
+    __m256i digits, fix;
+    uint32_t gen, prop, borrows;
+
+    count -= 32;
+    digits = _mm256_sub_epi8 (
+               _mm256_loadu_si256 ((const __m256i *) (n1ptr + count)),
+               _mm256_loadu_si256 ((const __m256i *) (n2ptr + count)));
+    gen = _mm256_movemask_epi8 (digits);
+    prop = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (digits, zero));
+    borrows = _bc_resolve_carries (gen, prop, 32, &borrow);
+    digits = _mm256_add_epi8 (digits, _bc_expand_mask32 (borrows));
+    fix = _mm256_and_si256 (_mm256_cmpgt_epi8 (zero, digits), ten);
+    _mm256_storeu_si256 ((__m256i *) (diffptr + count),
+                         _mm256_add_epi8 (digits, fix));
+  }
+#endif
+  while (count >= 16)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i ten = _mm_set1_epi8 (BASE);
+    __m128i digits, fix;
+    uint32_t gen, prop, borrows;
+
+    count -= 16;
+    digits = _mm_sub_epi8 (_mm_loadu_si128 ((const __m128i *) (n1ptr + count)),
+                           _mm_loadu_si128 ((const __m128i *) (n2ptr + count)));
+    gen = _mm_movemask_epi8 (digits);
+    prop = _mm_movemask_epi8 (_mm_cmpeq_epi8 (digits, zero));
+    borrows = _bc_resolve_carries (gen, prop, 16, &borrow);
+    digits = _mm_add_epi8 (digits, _bc_expand_mask16 (borrows));
+    fix = _mm_and_si128 (_mm_cmplt_epi8 (digits, zero), ten);
+    _mm_storeu_si128 ((__m128i *) (diffptr + count), _mm_add_epi8 (digits, fix));
+  }
+#endif
+  while (count-- > 0)
+  {
+    val = n1ptr[count] - n2ptr[count] - borrow;
+    borrow = (val < 0);
+    diffptr[count] = (borrow ? val + BASE : val);
+  }
+  return borrow;
+}
+
+/* Return how many of the first COUNT digits at N1PTR and N2PTR are
+   equal before the first that differs. */
+
+static int _bc_equal_digits (const char *n1ptr, const char *n2ptr, int count)
+{
+  int indx;
+#if defined(BC_SIMD)
+  uint32_t differ;
+#endif
+
+  indx = 0;
+#if defined(BC_SIMD)
+#if defined(__AVX2__)
+  for (; indx + 32 <= count; indx += 32)
+  {
+    differ = ~(uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (
+               _mm256_loadu_si256 ((const __m256i *) (n1ptr + indx)),
+               _mm256_loadu_si256 ((const __m256i *) (n2ptr + indx))));
+    if (differ != 0)
+      return indx + __builtin_ctz (differ);
+  }
+#endif
+  for (; indx + 16 <= count; indx += 16)
+  {
+    differ = 0xFFFF & ~(uint32_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (
+               _mm_loadu_si128 ((const __m128i *) (n1ptr + indx)),
+               _mm_loadu_si128 ((const __m128i *) (n2ptr + indx))));
+    if (differ != 0)
+      return indx + __builtin_ctz (differ);
+  }
+#endif
+  while (indx < count && n1ptr[indx] == n2ptr[indx])
+    indx++;
+  return indx;
+}
+
 
 /* Compare two bc numbers.  Return value is 0 if equal, -1 if N1 is less
    than N2 and +1 if N1 is greater than N2.  If USE_SIGN is false, just
@@ -130,7 +485,7 @@ static void _bc_rm_leading_zeros (bc_num num)
 static int _bc_do_compare (bc_num n1, bc_num n2, int use_sign, int ignore_last)
 {
   char *n1ptr, *n2ptr;
-  int  count;
+  int  count, indx;
 
   /* First, compare signs. */
   if (use_sign && n1->n_sign != n2->n_sign)
@@ -165,15 +520,10 @@ static int _bc_do_compare (bc_num n1, bc_num n2, int use_sign, int ignore_last)
   /* If we get here, they have the same number of integer digits.
      check the integer part and the equal length part of the fraction. */
   count = n1->n_len + MIN (n1->n_scale, n2->n_scale);
-  n1ptr = n1->n_value;
-  n2ptr = n2->n_value;
-
-  while ((count > 0) && (*n1ptr == *n2ptr))
-  {
-    n1ptr++;
-    n2ptr++;
-    count--;
-  }
+  indx = _bc_equal_digits (n1->n_value, n2->n_value, count);
+  n1ptr = n1->n_value + indx;
+  n2ptr = n2->n_value + indx;
+  count -= indx;
   if (ignore_last && count == 1 && n1->n_scale == n2->n_scale)
     return (0);
   if (count != 0)
@@ -346,29 +696,22 @@ static bc_num _bc_do_add (bc_num n1, bc_num n2, int scale_min)
   /* Now add the remaining fraction part and equal size integer parts. */
   n1bytes += n1->n_len;
   n2bytes += n2->n_len;
-  carry = 0;
-  while ((n1bytes > 0) && (n2bytes > 0))
-  {
-    *sumptr = *n1ptr-- + *n2ptr-- + carry;
-    if (*sumptr > (BASE - 1))
-    {
-      carry = 1;
-      *sumptr -= BASE;
-    }
-    else
-      carry = 0;
-    sumptr--;
-    n1bytes--;
-    n2bytes--;
-  }
-
-  /* Now add carry the longer integer part. */
+  count = MIN (n1bytes, n2bytes);
+  sumptr -= count;
+  n1ptr -= count;
+  n2ptr -= count;
+  n1bytes -= count;
+  n2bytes -= count;
+  carry = _bc_add_digits (sumptr + 1, n1ptr + 1, n2ptr + 1, count, 0);
+
+  /* Now add carry the longer integer part.  Once the carry is gone the
+     rest is a copy. */
   if (n1bytes == 0)
   {
     n1bytes = n2bytes;
     n1ptr = n2ptr;
   }
-  while (n1bytes-- > 0)
+  while ((n1bytes > 0) && (carry == 1))
   {
     *sumptr = *n1ptr-- + carry;
     if (*sumptr > (BASE - 1))
@@ -379,6 +722,12 @@ static bc_num _bc_do_add (bc_num n1, bc_num n2, int scale_min)
     else
       carry = 0;
     sumptr--;
+    n1bytes--;
+  }
+  if (n1bytes > 0)
+  {
+    sumptr -= n1bytes;
+    memcpy (sumptr + 1, n1ptr - n1bytes + 1, n1bytes);
   }
 
   /* Set final carry. */
@@ -453,23 +802,17 @@ static bc_num _bc_do_sub (bc_num n1, bc_num n2, int scale_min)
 
   /* Now do the equal length scale and integer parts. */
 
-  for (count = 0; count < min_len + min_scale; count++)
-  {
-    val = *n1ptr-- - *n2ptr-- - borrow;
-    if (val < 0)
-    {
-      val += BASE;
-      borrow = 1;
-    }
-    else
-      borrow = 0;
-    *diffptr-- = val;
-  }
+  count = min_len + min_scale;
+  diffptr -= count;
+  n1ptr -= count;
+  n2ptr -= count;
+  borrow = _bc_sub_digits (diffptr + 1, n1ptr + 1, n2ptr + 1, count, borrow);
 
-  /* If n1 has more digits then n2, we now do that subtract. */
+  /* If n1 has more digits then n2, we now do that subtract.  Once the
+     borrow is gone the rest is a copy. */
   if (diff_len != min_len)
   {
-    for (count = diff_len - min_len; count > 0; count--)
+    for (count = diff_len - min_len; (count > 0) && (borrow == 1); count--)
     {
       val = *n1ptr-- - borrow;
       if (val < 0)
@@ -481,6 +824,7 @@ static bc_num _bc_do_sub (bc_num n1, bc_num n2, int scale_min)
         borrow = 0;
       *diffptr-- = val;
     }
+    memcpy (diffptr - count + 1, n1ptr - count + 1, count);
   }
 
   /* Clean up and return. */
@@ -583,12 +927,276 @@ void bc_add (bc_num n1, bc_num n2, bc_num *result, int scale_min)
 /* Recursive vs non-recursive multiply crossover ranges. */
 #if defined(MULDIGITS)
 #include "muldigits.h"
+#elif defined(BC_LIMBS)
+#define MUL_BASE_DIGITS 4000    /* Limb schoolbook stays ahead much longer. */
+#elif defined(BC_SIMD)
+#define MUL_BASE_DIGITS 1000    /* So does the vector column kernel. */
 #else
 #define MUL_BASE_DIGITS 80
 #endif
 
-int mul_base_digits = MUL_BASE_DIGITS;
+/* Toom-3 takes over from Karatsuba for balanced operands at least this
+   long together. */
+#if !defined(MUL_TOOM3_DIGITS)
+#define MUL_TOOM3_DIGITS 3000
+#endif
+
+/* The NTT multiply takes over from both at this many digits together. */
+#if !defined(MUL_NTT_DIGITS)
+#if defined(BC_SIMD) || defined(BC_LIMBS)
+#define MUL_NTT_DIGITS 4000
+#else
+#define MUL_NTT_DIGITS 1200
+#endif
+#endif
+
 #define MUL_SMALL_DIGITS mul_base_digits/4
+#define MUL_REV_DIGITS 128      /* Reversed operand kept on the stack. */
+
+/* Set the multiply crossovers, counted in digits of both operands
+   together: schoolbook below BASE, Toom-3 from TOOM3 and the NTT from
+   NTT, in the current context.  A value of 0 keeps the current one.
+   tools/testmul measures them for a host; an AVR sketch has to time its
+   own. */
+
+void bc_set_mul_digits (int base, int toom3, int ntt)
+{
+  if (base > 0)
+    mul_base_digits = MAX (base, 4);    /* Karatsuba needs some digits. */
+  if (toom3 > 0)
+    mul_toom3_digits = toom3;
+  if (ntt > 0)
+    mul_ntt_digits = ntt;
+}
+
+/* Get the multiply crossovers set by bc_set_mul_digits. */
+
+void bc_get_mul_digits (int *base, int *toom3, int *ntt)
+{
+  *base = mul_base_digits;
+  *toom3 = mul_toom3_digits;
+  *ntt = mul_ntt_digits;
+}
+
+/* Multiplies of at least MUL_FORK_DIGITS digits (of both operands
+   together) may run their sub-products on the worker threads, down to
+   MUL_FORK_DEPTH levels of recursion.  See bc_start_threads. */
+
+#if !defined(MUL_FORK_DEPTH)
+#define MUL_FORK_DEPTH 3
+#endif
+#if !defined(MUL_FORK_DIGITS)
+#define MUL_FORK_DIGITS 20000
+#endif
+
+/* Set how many levels of a multiply fork their sub-products, and from
+   how many digits of both operands together, in the current context.
+   A DEPTH of 0 keeps every multiply on its own thread; a negative
+   value keeps the current one. */
+
+void bc_set_mul_fork (int depth, int digits)
+{
+  if (depth >= 0)
+    bc_current->c_fork_depth = depth;
+  if (digits >= 0)
+    bc_current->c_fork_digits = digits;
+}
+
+/* Forked sub-products.  bc_start_threads starts worker threads that
+   take tasks off one shared stack.  A multiply that forks pushes its
+   sub-products there and runs those no worker has taken until they
+   are all done.  Each worker works in a context of its own.  A task
+   only reads its factors and makes a new product, so threads share
+   nothing but the digits of the factors, and the product is only
+   handed back when the task is done. */
+
+#if defined(BC_THREADS)
+#define FORK_SPLIT_THREADS 8    /* Threads that beat the NTT's three. */
+
+typedef struct bc_task
+{
+  void (*t_run) (void *arg);	/* Does the work. */
+  void  *t_arg;
+  struct bc_task *t_next;	/* Next on the stack. */
+  int   *t_pending;		/* Tasks of the fork not done yet. */
+  const bc_context *t_from;	/* Context of the thread that forked. */
+  int    t_level;		/* Fork level the task runs at. */
+} bc_task;
+
+static pthread_mutex_t _bc_task_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _bc_task_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _bc_task_done = PTHREAD_COND_INITIALIZER;
+static bc_task *_bc_tasks;		/* The stack, under _bc_task_lock. */
+static int _bc_stopping;
+static pthread_t *_bc_workers;
+static int _bc_worker_count;
+static BC_THREAD_LOCAL int _bc_fork_level;
+
+/* Whether a multiply of DIGITS digits should fork its sub-products. */
+
+static int _bc_fork_here (int digits)
+{
+  return (_bc_worker_count > 0
+          && _bc_fork_level < bc_current->c_fork_depth
+          && digits >= bc_current->c_fork_digits);
+}
+
+#if defined(BC_NTT)
+/* Whether a multiply of DIGITS digits should split into forked
+   sub-products even where the NTT would take it whole.  Toom-3 above
+   the NTT does about 5/3 of the work, in five parts that each fork
+   three ways again, so it pays once there are well over three
+   threads. */
+
+static int _bc_fork_split (int digits)
+{
+  return (_bc_worker_count + 1 >= FORK_SPLIT_THREADS
+          && _bc_fork_here (digits));
+}
+#endif
+
+/* Run TASK at its fork level.  On a worker, whose context is its own,
+   the crossovers of the thread that forked it are copied in first. */
+
+static void _bc_task_run (bc_task *task)
+{
+  bc_context *ctx = bc_current;
+  const bc_context *from = task->t_from;
+  int level;
+
+  if (ctx != from)
+  {
+    ctx->c_mul_base_digits = from->c_mul_base_digits;
+    ctx->c_mul_toom3_digits = from->c_mul_toom3_digits;
+    ctx->c_mul_ntt_digits = from->c_mul_ntt_digits;
+    ctx->c_div_newton_digits = from->c_div_newton_digits;
+    ctx->c_div_bz_digits = from->c_div_bz_digits;
+    ctx->c_fork_depth = from->c_fork_depth;
+    ctx->c_fork_digits = from->c_fork_digits;
+  }
+  level = _bc_fork_level;
+  _bc_fork_level = task->t_level;
+  task->t_run (task->t_arg);
+  _bc_fork_level = level;
+}
+
+/* Take a task off the stack and run it: the top one, or if PENDING is
+   not NULL the top one of the fork it counts.  Returns FALSE if there
+   is no such task.  Called, and returns, with _bc_task_lock held. */
+
+static int _bc_task_take (int *pending)
+{
+  bc_task **link, *task;
+
+  for (link = &_bc_tasks; *link != NULL; link = &(*link)->t_next)
+    if (pending == NULL || (*link)->t_pending == pending)
+      break;
+  task = *link;
+  if (task == NULL)
+    return FALSE;
+  *link = task->t_next;
+  pthread_mutex_unlock (&_bc_task_lock);
+  _bc_task_run (task);
+  pthread_mutex_lock (&_bc_task_lock);
+  if (--*task->t_pending == 0)
+    pthread_cond_broadcast (&_bc_task_done);
+  return TRUE;
+}
+
+static void *_bc_worker (void *arg)
+{
+  bc_context ctx;
+
+  (void) arg;
+  bc_init_context (&ctx);
+  bc_use_context (&ctx);
+  pthread_mutex_lock (&_bc_task_lock);
+  for (;;)
+  {
+    while (_bc_tasks == NULL && !_bc_stopping)
+      pthread_cond_wait (&_bc_task_ready, &_bc_task_lock);
+    if (!_bc_task_take (NULL))
+      break;
+  }
+  pthread_mutex_unlock (&_bc_task_lock);
+  bc_free_context (&ctx);
+  return NULL;
+}
+
+/* Run the COUNT TASKS, pushed for the workers, and return when all of
+   them are done.  Meanwhile this thread runs those of them no worker
+   has taken.  It runs no others, as they would need its context set
+   to another thread's crossovers while its own tasks read them; the
+   workers see to those. */
+
+static void _bc_fork (bc_task *tasks, int count)
+{
+  int pending, indx;
+
+  pending = count;
+  pthread_mutex_lock (&_bc_task_lock);
+  for (indx = count - 1; indx >= 0; indx--)
+  {
+    tasks[indx].t_pending = &pending;
+    tasks[indx].t_from = bc_current;
+    tasks[indx].t_level = _bc_fork_level + 1;
+    tasks[indx].t_next = _bc_tasks;
+    _bc_tasks = &tasks[indx];
+  }
+  pthread_cond_broadcast (&_bc_task_ready);
+  while (pending > 0)
+    if (!_bc_task_take (&pending))
+      pthread_cond_wait (&_bc_task_done, &_bc_task_lock);
+  pthread_mutex_unlock (&_bc_task_lock);
+}
+#else
+#define _bc_fork_here(digits) 0
+#define _bc_fork_split(digits) 0
+#endif
+
+/* Start COUNT worker threads for forked multiplies, or one less than
+   the number of processors if COUNT is 0.  Returns how many workers
+   there are, which is 0 without BC_THREADS.  Threads are started and
+   stopped while no multiply is running. */
+
+int bc_start_threads (int count)
+{
+#if defined(BC_THREADS)
+  if (_bc_worker_count > 0)
+    return _bc_worker_count;
+  if (count <= 0)
+    count = (int) sysconf (_SC_NPROCESSORS_ONLN) - 1;
+  if (count <= 0)
+    return 0;
+  _bc_workers = (pthread_t *) malloc (count * sizeof (pthread_t));
+  if (_bc_workers == NULL) bc_out_of_memory ();
+  _bc_stopping = FALSE;
+  while (_bc_worker_count < count
+         && pthread_create (&_bc_workers[_bc_worker_count], NULL,
+                            _bc_worker, NULL) == 0)
+    _bc_worker_count++;
+  return _bc_worker_count;
+#else
+  (void) count;
+  return 0;
+#endif
+}
+
+/* Stop the worker threads, once they have finished what is queued. */
+
+void bc_stop_threads (void)
+{
+#if defined(BC_THREADS)
+  pthread_mutex_lock (&_bc_task_lock);
+  _bc_stopping = TRUE;
+  pthread_cond_broadcast (&_bc_task_ready);
+  pthread_mutex_unlock (&_bc_task_lock);
+  while (_bc_worker_count > 0)
+    pthread_join (_bc_workers[--_bc_worker_count], NULL);
+  free (_bc_workers);
+  _bc_workers = NULL;
+#endif
+}
 
 /* Multiply utility routines */
 
@@ -596,8 +1204,7 @@ static bc_num new_sub_num (int length, int scale, char *value)
 {
   bc_num temp;
 
-  temp = (bc_num) malloc (sizeof(bc_struct));
-  if (temp == NULL) bc_out_of_memory ();
+  temp = _bc_new_block (0);
   temp->n_sign = PLUS;
   temp->n_len = length;
   temp->n_scale = scale;
@@ -607,69 +1214,399 @@ static bc_num new_sub_num (int length, int scale, char *value)
   return temp;
 }
 
-static void
-_bc_simp_mul (bc_num n1, int n1len, bc_num n2, int n2len, bc_num *prod)
+#if defined(BC_LIMBS)
+/* Limb storage: nine decimal digits per 32 bit word.  A limb product
+   is below 10^18 and a column step adds at most 2*10^9 to it, so one
+   step always fits in 64 bits. */
+
+typedef uint32_t bc_limb;
+
+#define LIMB_DIGITS 9
+#define LIMB_BASE   1000000000UL
+
+/* Pack the LEN digits at DIGITS (most significant first) into LIMBS,
+   least significant limb first.  Returns the number of limbs used. */
+
+static int _bc_pack_limbs (const char *digits, int len, bc_limb *limbs)
 {
-  char *n1ptr, *n2ptr, *pvptr;
-  char *n1end, *n2end;          /* To the end of n1 and n2. */
-  int indx, sum, prodlen;
+  const char *ptr, *start;
+  bc_limb val;
+  int count;
 
-  prodlen = n1len + n2len + 1;
+  count = 0;
+  ptr = digits + len;
+  while (ptr > digits)
+  {
+    start = (ptr - digits > LIMB_DIGITS ? ptr - LIMB_DIGITS : digits);
+    for (val = 0; start < ptr; start++)
+      val = val * BASE + *start;
+    limbs[count++] = val;
+    ptr -= MIN (ptr - digits, LIMB_DIGITS);
+  }
+  return count;
+}
 
-  *prod = bc_new_num (prodlen, 0);
+/* Unpack COUNT limbs into exactly LEN digits at DIGITS, most significant
+   first.  Digits not covered by the limbs are zeroed. */
 
-  n1end = (char *) (n1->n_value + n1len - 1);
-  n2end = (char *) (n2->n_value + n2len - 1);
-  pvptr = (char *) ((*prod)->n_value + prodlen - 1);
-  sum = 0;
+static void _bc_unpack_limbs (const bc_limb *limbs, int count, char *digits,
+                              int len)
+{
+  char *ptr;
+  bc_limb val;
+  int indx, k;
 
-  /* Here is the loop... */
-  for (indx = 0; indx < prodlen - 1; indx++)
+  ptr = digits + len;
+  for (indx = 0; indx < count && ptr > digits; indx++)
   {
-    n1ptr = (char *) (n1end - MAX(0, indx - n2len + 1));
-    n2ptr = (char *) (n2end - MIN(indx, n2len - 1));
-    while ((n1ptr >= n1->n_value) && (n2ptr <= n2end))
-      sum += *n1ptr-- * *n2ptr++;
-    *pvptr-- = sum % BASE;
-    sum = sum / BASE;
+    val = limbs[indx];
+    for (k = 0; k < LIMB_DIGITS && ptr > digits; k++)
+    {
+      *--ptr = val % BASE;
+      val /= BASE;
+    }
   }
-  *pvptr = sum;
+  while (ptr > digits)
+    *--ptr = 0;
 }
 
+/* Schoolbook multiply on limbs.  Same contract as _bc_simp_mul.  Each
+   product limb is summed as a column.  Up to LIMB_BLOCK limb products go
+   into the 64 bit column sum before it is normalized, so there is one
+   division per block of products instead of one per product. */
+
+#define LIMB_BLOCK 16
 
-/* A special adder/subtractor for the recursive divide and conquer
-   multiply algorithm.  Note: if sub is called, accum must
-   be larger that what is being subtracted.  Also, accum and val
-   must have n_scale = 0.  (e.g. they must look like integers. *) */
 static void
-_bc_shift_addsub (bc_num accum, bc_num val, int shift, int sub)
+_bc_limb_mul (bc_num n1, int n1len, bc_num n2, int n2len, bc_num *prod)
 {
-  signed char *accp, *valp;
-  int  count, carry;
+  bc_limb *l1, *l2, *lp;
+  uint64_t step, carry;
+  int c1, c2, i, k, first, last, stop, prodlen;
 
-  count = val->n_len;
-  if (val->n_value[0] == 0)
-    count--;
-  assert (accum->n_len + accum->n_scale >= shift + count);
+  prodlen = n1len + n2len + 1;
+  *prod = bc_new_num (prodlen, 0);
 
-  /* Set up pointers and others */
-  accp = (signed char *)(accum->n_value +
-                         accum->n_len + accum->n_scale - shift - 1);
-  valp = (signed char *)(val->n_value + val->n_len - 1);
-  carry = 0;
+  /* One block holds both operands and the product. */
+  c1 = (n1len + LIMB_DIGITS - 1) / LIMB_DIGITS;
+  c2 = (n2len + LIMB_DIGITS - 1) / LIMB_DIGITS;
+  l1 = (bc_limb *) malloc (2 * (c1 + c2) * sizeof(bc_limb));
+  if (l1 == NULL) bc_out_of_memory();
+  l2 = l1 + c1;
+  lp = l2 + c2;
+  _bc_pack_limbs (n1->n_value, n1len, l1);
+  _bc_pack_limbs (n2->n_value, n2len, l2);
 
-  if (sub) {
-    /* Subtraction, carry is really borrow. */
-    while (count--) {
-      *accp -= *valp-- + carry;
-      if (*accp < 0) {
-        carry = 1;
-        *accp-- += BASE;
-      } else {
-        carry = 0;
-        accp--;
-      }
+  carry = 0;
+  for (k = 0; k < c1 + c2 - 1; k++)
+  {
+    first = MAX (0, k - c2 + 1);
+    last = MIN (k, c1 - 1);
+    step = carry % LIMB_BASE;
+    carry /= LIMB_BASE;
+    for (i = first; i <= last; i = stop)
+    {
+      stop = MIN (i + LIMB_BLOCK, last + 1);
+      for (; i < stop; i++)
+        step += (uint64_t) l1[i] * l2[k - i];
+      carry += step / LIMB_BASE;
+      step %= LIMB_BASE;
+    }
+    lp[k] = (bc_limb) step;
+  }
+  lp[c1 + c2 - 1] = (bc_limb) carry;
+
+  _bc_unpack_limbs (lp, c1 + c2, (*prod)->n_value, prodlen);
+  free (l1);
+}
+
+/* Limb square.  Limbs i and k - i of column k give the same product,
+   so half the column is summed and doubled, then the middle limb's
+   square is added. */
+
+static void
+_bc_limb_sqr (bc_num n1, int n1len, bc_num *prod)
+{
+  bc_limb *l1, *lp;
+  uint64_t step, carry, high;
+  int c1, i, k, first, mid, stop, prodlen;
+
+  prodlen = 2 * n1len + 1;
+  *prod = bc_new_num (prodlen, 0);
+
+  c1 = (n1len + LIMB_DIGITS - 1) / LIMB_DIGITS;
+  l1 = (bc_limb *) malloc (3 * c1 * sizeof(bc_limb));
+  if (l1 == NULL) bc_out_of_memory();
+  lp = l1 + c1;
+  _bc_pack_limbs (n1->n_value, n1len, l1);
+
+  carry = 0;
+  for (k = 0; k < 2 * c1 - 1; k++)
+  {
+    first = MAX (0, k - c1 + 1);
+    mid = (k + 1) / 2;
+    step = 0;
+    high = 0;
+    for (i = first; i < mid; i = stop)
+    {
+      stop = MIN (i + LIMB_BLOCK, mid);
+      for (; i < stop; i++)
+        step += (uint64_t) l1[i] * l1[k - i];
+      high += step / LIMB_BASE;
+      step %= LIMB_BASE;
     }
+    step = 2 * step + carry % LIMB_BASE;
+    high = 2 * high + carry / LIMB_BASE;
+    if (k % 2 == 0)
+      step += (uint64_t) l1[k / 2] * l1[k / 2];
+    carry = high + step / LIMB_BASE;
+    lp[k] = (bc_limb) (step % LIMB_BASE);
+  }
+  lp[2 * c1 - 1] = (bc_limb) carry;
+
+  _bc_unpack_limbs (lp, 2 * c1, (*prod)->n_value, prodlen);
+  free (l1);
+}
+#endif
+
+#if defined(BC_SIMD)
+/* Return the sum of N1PTR[i] * N2PTR[i] over the first COUNT digits.
+   This is one product column when N2PTR holds the other operand in
+   reverse order.  On x86-64 hosts the digit products are formed and
+   summed in pairs by pmaddubsw (SSSE3/AVX2) or pmaddwd (SSE2) into 32
+   bit lanes, and the lanes are only added together at the end. */
+
+static int _bc_dot_digits (const char *n1ptr, const char *n2ptr, int count)
+{
+  int indx, sum;
+  __m128i acc, lanes;
+
+  indx = 0;
+  acc = _mm_setzero_si128 ();
+#if defined(__AVX2__)
+  if (count >= 32)
+  {
+    const __m256i ones = _mm256_set1_epi16 (1);
+    __m256i acc256 = _mm256_setzero_si256 ();
+
+    for (; indx + 32 <= count; indx += 32)
+      acc256 = _mm256_add_epi32 (acc256, _mm256_madd_epi16 (
+                 _mm256_maddubs_epi16 (
+                   _mm256_loadu_si256 ((const __m256i *) (n1ptr + indx)),
+                   _mm256_loadu_si256 ((const __m256i *) (n2ptr + indx))),
+                 ones));
+    acc = _mm_add_epi32 (_mm256_castsi256_si128 (acc256),
+                         _mm256_extracti128_si256 (acc256, 1));
+  }
+#endif
+  for (; indx + 16 <= count; indx += 16)
+  {
+    __m128i d1 = _mm_loadu_si128 ((const __m128i *) (n1ptr + indx));
+    __m128i d2 = _mm_loadu_si128 ((const __m128i *) (n2ptr + indx));
+#if defined(__SSSE3__)
+    acc = _mm_add_epi32 (acc, _mm_madd_epi16 (_mm_maddubs_epi16 (d1, d2),
+                                              _mm_set1_epi16 (1)));
+#else
+    const __m128i zero = _mm_setzero_si128 ();
+
+    acc = _mm_add_epi32 (acc, _mm_madd_epi16 (_mm_unpacklo_epi8 (d1, zero),
+                                              _mm_unpacklo_epi8 (d2, zero)));
+    acc = _mm_add_epi32 (acc, _mm_madd_epi16 (_mm_unpackhi_epi8 (d1, zero),
+                                              _mm_unpackhi_epi8 (d2, zero)));
+#endif
+  }
+  lanes = _mm_add_epi32 (acc, _mm_shuffle_epi32 (acc, 0x4E));
+  lanes = _mm_add_epi32 (lanes, _mm_shuffle_epi32 (lanes, 0xB1));
+  sum = _mm_cvtsi128_si32 (lanes);
+  for (; indx < count; indx++)
+    sum += n1ptr[indx] * n2ptr[indx];
+  return sum;
+}
+#endif
+
+static void
+_bc_simp_mul (bc_num n1, int n1len, bc_num n2, int n2len, bc_num *prod)
+{
+  char *pvptr;
+  char *n1end, *n2end;          /* To the end of n1 and n2. */
+  int indx, sum, prodlen;
+#if defined(BC_SIMD)
+  char revbuf[MUL_REV_DIGITS];  /* n2 reversed, when it fits. */
+  char *n2rev;
+  int first, last;
+#else
+  char *n1ptr, *n2ptr;
+#endif
+
+#if defined(BC_LIMBS)
+  if (n1len >= LIMB_DIGITS && n2len >= LIMB_DIGITS)
+  {
+    _bc_limb_mul (n1, n1len, n2, n2len, prod);
+    return;
+  }
+#endif
+
+  prodlen = n1len + n2len + 1;
+
+  *prod = bc_new_num (prodlen, 0);
+
+  n1end = (char *) (n1->n_value + n1len - 1);
+  n2end = (char *) (n2->n_value + n2len - 1);
+  pvptr = (char *) ((*prod)->n_value + prodlen - 1);
+  sum = 0;
+
+#if defined(BC_SIMD)
+  /* With n2 reversed, product column INDX pairs a contiguous run of n1
+     with a contiguous run of n2rev, which _bc_dot_digits can take 16 or
+     32 digits at a time.  The column sums carry into each other, so the
+     only normalizing is the one % and / per product digit. */
+  if (n2len <= MUL_REV_DIGITS)
+    n2rev = revbuf;
+  else
+  {
+    n2rev = (char *) malloc (n2len);
+    if (n2rev == NULL) bc_out_of_memory();
+  }
+  for (indx = 0; indx < n2len; indx++)
+    n2rev[indx] = n2end[-indx];
+
+  for (indx = 0; indx < prodlen - 1; indx++)
+  {
+    first = MAX(0, indx - n1len + 1);
+    last = MIN(indx, n2len - 1);
+    sum += _bc_dot_digits (n1end - indx + first, n2rev + first,
+                           last - first + 1);
+    *pvptr-- = sum % BASE;
+    sum = sum / BASE;
+  }
+  *pvptr = sum;
+
+  if (n2rev != revbuf)
+    free (n2rev);
+#else
+  /* Here is the loop... */
+  for (indx = 0; indx < prodlen - 1; indx++)
+  {
+    n1ptr = (char *) (n1end - MAX(0, indx - n2len + 1));
+    n2ptr = (char *) (n2end - MIN(indx, n2len - 1));
+    while ((n1ptr >= n1->n_value) && (n2ptr <= n2end))
+      sum += *n1ptr-- * *n2ptr++;
+    *pvptr-- = sum % BASE;
+    sum = sum / BASE;
+  }
+  *pvptr = sum;
+#endif
+}
+
+/* The square of N1, with the contract of _bc_simp_mul.  Digits i and
+   indx - i of product column INDX give the same product, so only half
+   of each column is summed and doubled, and the square of the middle
+   digit is added when there is one. */
+
+static void
+_bc_simp_sqr (bc_num n1, int n1len, bc_num *prod)
+{
+  char *pvptr;
+  char *n1end;
+  int indx, sum, prodlen, first, last;
+#if defined(BC_SIMD)
+  char revbuf[MUL_REV_DIGITS];  /* n1 reversed, when it fits. */
+  char *n1rev;
+#else
+  char *n1ptr, *n2ptr;
+  int half;
+#endif
+
+#if defined(BC_LIMBS)
+  if (n1len >= LIMB_DIGITS)
+  {
+    _bc_limb_sqr (n1, n1len, prod);
+    return;
+  }
+#endif
+
+  prodlen = 2 * n1len + 1;
+
+  *prod = bc_new_num (prodlen, 0);
+
+  n1end = (char *) (n1->n_value + n1len - 1);
+  pvptr = (char *) ((*prod)->n_value + prodlen - 1);
+  sum = 0;
+
+#if defined(BC_SIMD)
+  if (n1len <= MUL_REV_DIGITS)
+    n1rev = revbuf;
+  else
+  {
+    n1rev = (char *) malloc (n1len);
+    if (n1rev == NULL) bc_out_of_memory();
+  }
+  for (indx = 0; indx < n1len; indx++)
+    n1rev[indx] = n1end[-indx];
+
+  for (indx = 0; indx < prodlen - 1; indx++)
+  {
+    first = MAX(0, indx - n1len + 1);
+    last = indx - first;
+    sum += 2 * _bc_dot_digits (n1end - indx + first, n1rev + first,
+                               (last - first + 1) / 2);
+    if (indx % 2 == 0)
+      sum += n1rev[indx / 2] * n1rev[indx / 2];
+    *pvptr-- = sum % BASE;
+    sum = sum / BASE;
+  }
+  *pvptr = sum;
+
+  if (n1rev != revbuf)
+    free (n1rev);
+#else
+  for (indx = 0; indx < prodlen - 1; indx++)
+  {
+    first = MAX(0, indx - n1len + 1);
+    last = indx - first;
+    n1ptr = (char *) (n1end - first);
+    n2ptr = (char *) (n1end - last);
+    half = 0;
+    while (n2ptr < n1ptr)
+      half += *n1ptr-- * *n2ptr++;
+    sum += 2 * half;
+    if (n1ptr == n2ptr)
+      sum += *n1ptr * *n1ptr;
+    *pvptr-- = sum % BASE;
+    sum = sum / BASE;
+  }
+  *pvptr = sum;
+#endif
+}
+
+
+/* A special adder/subtractor for the recursive divide and conquer
+   multiply algorithm.  Note: if sub is called, accum must
+   be larger that what is being subtracted.  Also, accum and val
+   must have n_scale = 0.  (e.g. they must look like integers. *) */
+static void
+_bc_shift_addsub (bc_num accum, bc_num val, int shift, int sub)
+{
+  signed char *accp, *valp;
+  int  count, carry;
+
+  count = val->n_len;
+  if (val->n_value[0] == 0)
+    count--;
+  assert (accum->n_len + accum->n_scale >= shift + count);
+
+  /* Set up pointers and others */
+  accp = (signed char *)(accum->n_value +
+                         accum->n_len + accum->n_scale - shift - 1);
+  valp = (signed char *)(val->n_value + val->n_len - 1);
+  carry = 0;
+
+  if (sub) {
+    /* Subtraction, carry is really borrow. */
+    accp -= count;
+    valp -= count;
+    carry = _bc_sub_digits ((char *) accp + 1, (char *) accp + 1,
+                            (char *) valp + 1, count, 0);
     while (carry) {
       *accp -= carry;
       if (*accp < 0)
@@ -679,16 +1616,10 @@ _bc_shift_addsub (bc_num accum, bc_num val, int shift, int sub)
     }
   } else {
     /* Addition */
-    while (count--) {
-      *accp += *valp-- + carry;
-      if (*accp > (BASE - 1)) {
-        carry = 1;
-        *accp-- -= BASE;
-      } else {
-        carry = 0;
-        accp--;
-      }
-    }
+    accp -= count;
+    valp -= count;
+    carry = _bc_add_digits ((char *) accp + 1, (char *) accp + 1,
+                            (char *) valp + 1, count, 0);
     while (carry) {
       *accp += carry;
       if (*accp > (BASE - 1))
@@ -699,820 +1630,3050 @@ _bc_shift_addsub (bc_num accum, bc_num val, int shift, int sub)
   }
 }
 
-/* Recursive divide and conquer multiply algorithm.
-   Based on
-   Let u = u0 + u1*(b^n)
-   Let v = v0 + v1*(b^n)
-   Then uv = (B^2n+B^n)*u1*v1 + B^n*(u1-u0)*(v0-v1) + (B^n+1)*u0*v0
+#if defined(BC_NTT)
+/* Number theoretic transform multiply.  Operands are packed into base
+   10^6 coefficients and convolved modulo three NTT primes, each of them
+   c*2^k+1 with 3 as a primitive root.  A convolution sum is below
+   2^23 * 10^12 < 2^64, so the Chinese remainder step (Garner's method)
+   gives it exactly in 64 bits.  All arithmetic is integer; products are
+   reduced with Montgomery multiplication (R = 2^32). */
+
+#define NTT_DIGITS 6
+#define NTT_BASE   1000000UL
+#define NTT_MAX_LOG 23          /* Largest transform of all three primes. */
+
+typedef struct ntt_prime {
+  uint32_t p;                   /* The prime. */
+  uint32_t pinv;                /* -1/p mod 2^32. */
+  uint32_t one;                 /* R mod p, 1 in Montgomery form. */
+} ntt_prime;
+
+static const uint32_t _bc_ntt_primes[3] = { 998244353, 167772161, 469762049 };
+
+static uint32_t _bc_ntt_redc (const ntt_prime *pr, uint64_t t)
+{
+  uint32_t m, r;
+
+  m = (uint32_t) t * pr->pinv;
+  r = (uint32_t) ((t + (uint64_t) m * pr->p) >> 32);
+  return (r >= pr->p ? r - pr->p : r);
+}
+
+static uint32_t _bc_ntt_mulmod (const ntt_prime *pr, uint32_t a, uint32_t b)
+{
+  return _bc_ntt_redc (pr, (uint64_t) a * b);
+}
+
+/* BASE to the EXPO power modulo MOD, plainly. */
+
+static uint32_t _bc_ntt_pow (uint64_t base, uint64_t expo, uint32_t mod)
+{
+  uint64_t result;
+
+  result = 1;
+  base %= mod;
+  while (expo > 0)
+  {
+    if (expo & 1)
+      result = result * base % mod;
+    base = base * base % mod;
+    expo >>= 1;
+  }
+  return (uint32_t) result;
+}
+
+static void _bc_ntt_setup (ntt_prime *pr, uint32_t p)
+{
+  uint32_t inv;
+  int i;
+
+  inv = p;                      /* Newton: p*p == 1 mod 8. */
+  for (i = 0; i < 4; i++)
+    inv *= 2 - p * inv;
+  pr->p = p;
+  pr->pinv = 0 - inv;
+  pr->one = (uint32_t) (((uint64_t) 1 << 32) % p);
+}
+
+/* Forward transform of the SIZE values at DATA (decimation in
+   frequency, natural order in, bit reversed order out). */
+
+static void _bc_ntt_forward (const ntt_prime *pr, uint32_t *data, int size)
+{
+  uint32_t w, wlen, u, v, p;
+  int len, i, j;
+
+  p = pr->p;
+  for (len = size / 2; len >= 1; len /= 2)
+  {
+    wlen = _bc_ntt_pow (3, (p - 1) / (2 * len), p);
+    wlen = (uint32_t) ((uint64_t) wlen * pr->one % p);
+    for (i = 0; i < size; i += 2 * len)
+    {
+      w = pr->one;
+      for (j = i; j < i + len; j++)
+      {
+        u = data[j];
+        v = data[j + len];
+        data[j] = (u + v >= p ? u + v - p : u + v);
+        data[j + len] = _bc_ntt_mulmod (pr, u >= v ? u - v : u + p - v, w);
+        w = _bc_ntt_mulmod (pr, w, wlen);
+      }
+    }
+  }
+}
+
+/* Inverse transform, without the 1/SIZE factor (decimation in time, bit
+   reversed order in, natural order out). */
+
+static void _bc_ntt_inverse (const ntt_prime *pr, uint32_t *data, int size)
+{
+  uint32_t w, wlen, u, v, p;
+  int len, i, j;
+
+  p = pr->p;
+  for (len = 1; len < size; len *= 2)
+  {
+    wlen = _bc_ntt_pow (3, (p - 1) - (p - 1) / (2 * len), p);
+    wlen = (uint32_t) ((uint64_t) wlen * pr->one % p);
+    for (i = 0; i < size; i += 2 * len)
+    {
+      w = pr->one;
+      for (j = i; j < i + len; j++)
+      {
+        u = data[j];
+        v = _bc_ntt_mulmod (pr, data[j + len], w);
+        data[j] = (u + v >= p ? u + v - p : u + v);
+        data[j + len] = (u >= v ? u - v : u + p - v);
+        w = _bc_ntt_mulmod (pr, w, wlen);
+      }
+    }
+  }
+}
+
+/* Pack the LEN digits at DIGITS into SIZE coefficients of NTT_DIGITS
+   digits, least significant first, zero filled. */
+
+static void _bc_ntt_pack (const char *digits, int len, uint32_t *coef,
+                          int size)
+{
+  const char *ptr, *start;
+  uint32_t val;
+  int count;
+
+  count = 0;
+  ptr = digits + len;
+  while (ptr > digits)
+  {
+    start = (ptr - digits > NTT_DIGITS ? ptr - NTT_DIGITS : digits);
+    for (val = 0; start < ptr; start++)
+      val = val * BASE + *start;
+    coef[count++] = val;
+    ptr -= MIN (ptr - digits, NTT_DIGITS);
+  }
+  while (count < size)
+    coef[count++] = 0;
+}
+
+/* Can _bc_ntt_mul take operands of N1LEN and N2LEN digits? */
+
+static int _bc_ntt_fits (int n1len, int n2len)
+{
+  return ((n1len + NTT_DIGITS - 1) / NTT_DIGITS
+          + (n2len + NTT_DIGITS - 1) / NTT_DIGITS
+          <= (1L << NTT_MAX_LOG));
+}
+
+/* One prime's share of an NTT multiply: the cyclic convolution of the
+   operands modulo the prime, in res, with tmp as scratch. */
+
+typedef struct ntt_pass {
+  ntt_prime pr;
+  bc_num   n1, n2;
+  int      n1len, n2len;
+  int      size;                /* Transform length. */
+  int      count;               /* Coefficients of the product. */
+  int      square;
+  uint32_t *res, *tmp;
+} ntt_pass;
+
+static void _bc_ntt_pass (void *arg)
+{
+  ntt_pass *pass = (ntt_pass *) arg;
+  const ntt_prime *pr = &pass->pr;
+  uint32_t *res = pass->res, *tmp = pass->tmp, scale;
+  int indx, size = pass->size;
+
+  _bc_ntt_pack (pass->n1->n_value, pass->n1len, res, size);
+  _bc_ntt_forward (pr, res, size);
+  if (pass->square)
+    for (indx = 0; indx < size; indx++)
+      res[indx] = _bc_ntt_mulmod (pr, res[indx], res[indx]);
+  else
+  {
+    _bc_ntt_pack (pass->n2->n_value, pass->n2len, tmp, size);
+    _bc_ntt_forward (pr, tmp, size);
+    for (indx = 0; indx < size; indx++)
+      res[indx] = _bc_ntt_mulmod (pr, res[indx], tmp[indx]);
+  }
+  _bc_ntt_inverse (pr, res, size);
+
+  /* Undo the 1/R from the pointwise multiply, the 1/R from this one
+     and the factor SIZE from the transforms. */
+  scale = _bc_ntt_pow (size, pr->p - 2, pr->p);
+  scale = (uint32_t) ((uint64_t) scale * pr->one % pr->p);
+  scale = (uint32_t) ((uint64_t) scale * pr->one % pr->p);
+  for (indx = 0; indx < pass->count; indx++)
+    res[indx] = _bc_ntt_mulmod (pr, res[indx], scale);
+}
+
+/* NTT multiply.  Same contract as _bc_simp_mul.  A square needs only
+   the one forward transform per prime.  The three primes are
+   independent, and are forked when the multiply is long enough. */
 
-   B is the base of storage, number of digits in u1,u0 close to equal.
-*/
 static void
-_bc_rec_mul (bc_num u, int ulen, bc_num v, int vlen, bc_num *prod)
+_bc_ntt_mul (bc_num n1, int n1len, bc_num n2, int n2len, bc_num *prod)
 {
-  bc_num u0, u1, v0, v1;
-  bc_num m1, m2, m3, d1, d2;
-  int n, prodlen, m1zero;
-  int d1len, d2len;
+  ntt_pass pass[3];
+  uint32_t *res[3], *scratch;
+  uint32_t p1, p2, p3, inv12, inv123, r1, t2, t3;
+  uint64_t val, carry;
+  char *pvptr;
+  int c1, c2, size, indx, k, prodlen, square, fork, scratches;
+#if defined(BC_THREADS)
+  bc_task tasks[3];
+#endif
 
-  /* Base case? */
-  if ((ulen + vlen) < mul_base_digits
-      || ulen < MUL_SMALL_DIGITS
-      || vlen < MUL_SMALL_DIGITS ) {
-    _bc_simp_mul (u, ulen, v, vlen, prod);
-    return;
+  prodlen = n1len + n2len + 1;
+  *prod = bc_new_num (prodlen, 0);
+  square = (n1 == n2 && n1len == n2len);
+  fork = _bc_fork_here (n1len + n2len);
+
+  c1 = (n1len + NTT_DIGITS - 1) / NTT_DIGITS;
+  c2 = (n2len + NTT_DIGITS - 1) / NTT_DIGITS;
+  for (size = 1; size < c1 + c2 - 1; size *= 2)
+    ;
+
+  /* Three result transforms and the scratch transforms, one for all
+     primes or one each when they are forked, in one block. */
+  scratches = (square ? 0 : fork ? 3 : 1);
+  res[0] = (uint32_t *) malloc ((3 + scratches) * (size_t) size
+                                * sizeof(uint32_t));
+  if (res[0] == NULL) bc_out_of_memory();
+  res[1] = res[0] + size;
+  res[2] = res[1] + size;
+  scratch = res[2] + size;
+
+  for (k = 0; k < 3; k++)
+  {
+    _bc_ntt_setup (&pass[k].pr, _bc_ntt_primes[k]);
+    pass[k].n1 = n1;
+    pass[k].n1len = n1len;
+    pass[k].n2 = n2;
+    pass[k].n2len = n2len;
+    pass[k].size = size;
+    pass[k].count = c1 + c2 - 1;
+    pass[k].square = square;
+    pass[k].res = res[k];
+    pass[k].tmp = scratch + (scratches > 1 ? k * (size_t) size : 0);
+  }
+#if defined(BC_THREADS)
+  if (fork)
+  {
+    for (k = 0; k < 3; k++)
+    {
+      tasks[k].t_run = _bc_ntt_pass;
+      tasks[k].t_arg = &pass[k];
+    }
+    _bc_fork (tasks, 3);
+  }
+  else
+#endif
+  for (k = 0; k < 3; k++)
+    _bc_ntt_pass (&pass[k]);
+
+  /* Garner: val = r1 + p1*t2 + p1*p2*t3, then carry in NTT_BASE. */
+  p1 = pass[0].pr.p;
+  p2 = pass[1].pr.p;
+  p3 = pass[2].pr.p;
+  inv12 = _bc_ntt_pow (p1, p2 - 2, p2);
+  inv123 = _bc_ntt_pow ((uint64_t) p1 * p2 % p3, p3 - 2, p3);
+  pvptr = (*prod)->n_value + prodlen;
+  carry = 0;
+  for (indx = 0; indx < c1 + c2 - 1 || carry > 0; indx++)
+  {
+    val = carry;
+    if (indx < c1 + c2 - 1)
+    {
+      r1 = res[0][indx];
+      t2 = (uint32_t) ((res[1][indx] + (uint64_t) p2 - r1 % p2) % p2
+                       * inv12 % p2);
+      t3 = (uint32_t) ((res[2][indx] + (uint64_t) p3
+                        - (r1 + (uint64_t) p1 * t2) % p3) % p3
+                       * inv123 % p3);
+      val += r1 + (uint64_t) p1 * t2 + (uint64_t) p1 * p2 * t3;
+    }
+    carry = val / NTT_BASE;
+    val %= NTT_BASE;
+    for (k = 0; k < NTT_DIGITS && pvptr > (*prod)->n_value; k++)
+    {
+      *--pvptr = val % BASE;
+      val /= BASE;
+    }
+  }
+
+  free (res[0]);
+}
+#endif
+
+static void _bc_rec_mul (bc_num u, int ulen, bc_num v, int vlen,
+                         bc_num *prod);
+
+/* A sub-product for _bc_mul_jobs. */
+
+typedef struct bc_mul_job
+{
+  bc_num j_u, j_v;		/* The factors, integers. */
+  bc_num j_prod;		/* Their magnitudes multiplied. */
+} bc_mul_job;
+
+#if defined(BC_THREADS)
+static void _bc_mul_job_run (void *arg)
+{
+  bc_mul_job *job = (bc_mul_job *) arg;
+
+  _bc_rec_mul (job->j_u, job->j_u->n_len, job->j_v, job->j_v->n_len,
+               &job->j_prod);
+}
+#endif
+
+/* Multiply out the COUNT (at most 5) JOBS, the sub-products of a
+   multiply of DIGITS digits in all.  A zero factor gives a copy of
+   _zero_; the others go to _bc_rec_mul, and are forked when the
+   multiply is long enough. */
+
+static void _bc_mul_jobs (bc_mul_job *jobs, int count, int digits)
+{
+  bc_mul_job *job;
+#if defined(BC_THREADS)
+  bc_task tasks[5];
+  int forks;
+#endif
+
+  for (job = jobs; job < jobs + count; job++)
+    job->j_prod = (bc_is_zero (job->j_u) || bc_is_zero (job->j_v)
+                   ? bc_copy_num (_zero_) : NULL);
+#if defined(BC_THREADS)
+  if (_bc_fork_here (digits))
+  {
+    for (job = jobs, forks = 0; job < jobs + count; job++)
+      if (job->j_prod == NULL)
+      {
+        tasks[forks].t_run = _bc_mul_job_run;
+        tasks[forks].t_arg = job;
+        forks++;
+      }
+    if (forks > 1)
+    {
+      _bc_fork (tasks, forks);
+      return;
+    }
+  }
+#else
+  (void) digits;
+#endif
+  for (job = jobs; job < jobs + count; job++)
+    if (job->j_prod == NULL)
+      _bc_rec_mul (job->j_u, job->j_u->n_len, job->j_v, job->j_v->n_len,
+                   &job->j_prod);
+}
+
+/* Toom-3 utility routines.  These work on integers (n_scale == 0) of
+   either sign, as the evaluation and interpolation values can be
+   negative. */
+
+/* Split the LEN digits at NUM into N0 + N1*(b^n) + N2*(b^2n). */
+
+static void
+_bc_toom_split (bc_num num, int len, int n, bc_num *n0, bc_num *n1,
+                bc_num *n2)
+{
+  *n2 = new_sub_num (len - 2 * n, 0, num->n_value);
+  *n1 = new_sub_num (n, 0, num->n_value + len - 2 * n);
+  *n0 = new_sub_num (n, 0, num->n_value + len - n);
+  _bc_rm_leading_zeros (*n2);
+  _bc_rm_leading_zeros (*n1);
+  _bc_rm_leading_zeros (*n0);
+}
+
+/* The product of JOB, done by _bc_mul_jobs, with its sign. */
+
+static bc_num
+_bc_toom_signed (bc_mul_job *job)
+{
+  bc_num prod = job->j_prod;
+
+  if (prod != _zero_)
+  {
+    prod->n_sign = (job->j_u->n_sign == job->j_v->n_sign ? PLUS : MINUS);
+    _bc_rm_leading_zeros (prod);
+  }
+  return prod;
+}
+
+/* Divide NUM in place by the one digit DIVISOR, which divides it
+   exactly.  NUM must not be shared. */
+
+static void
+_bc_toom_div (bc_num num, int divisor)
+{
+  char *nptr;
+  int count, rem, val;
+
+  if (bc_is_zero (num))
+    return;
+  rem = 0;
+  nptr = num->n_value;
+  for (count = num->n_len; count > 0; count--)
+  {
+    val = rem * BASE + *nptr;
+    *nptr++ = val / divisor;
+    rem = val % divisor;
+  }
+  assert (rem == 0);
+  _bc_rm_leading_zeros (num);
+}
+
+/* Toom-3 multiply, using Bodrato's evaluation and interpolation.
+   Let u = u0 + u1*(b^n) + u2*(b^2n), and v the same way, as polynomials
+   in x = b^n.  The product w = uv has degree 4 and is found from its
+   values at x = 0, 1, -1, -2 and infinity, which are five recursive
+   multiplies of about n digits each instead of Karatsuba's 2n.  U and V
+   must both be longer than 2n digits.  When U is V the values of q are
+   those of p, and the five multiplies are squares. */
+
+static void
+_bc_toom3_mul (bc_num u, int ulen, bc_num v, int vlen, bc_num *prod)
+{
+  bc_num u0, u1, u2, v0, v1, v2;
+  bc_num p, p1, pm1, pm2, q, q1, qm1, qm2;
+  bc_num w0, w1, wm1, wm2, winf, t;
+  bc_mul_job jobs[5];
+  int n, prodlen, square;
+
+  /* Calculate n -- the u and v split point in digits. */
+  n = (MAX(ulen, vlen) + 2) / 3;
+  square = (u == v && ulen == vlen);
+  _bc_toom_split (u, ulen, n, &u0, &u1, &u2);
+  if (square)
+  {
+    v0 = bc_copy_num (u0);
+    v1 = bc_copy_num (u1);
+    v2 = bc_copy_num (u2);
+  }
+  else
+    _bc_toom_split (v, vlen, n, &v0, &v1, &v2);
+
+  /* Evaluate: p(1) = u0+u1+u2, p(-1) = u0-u1+u2,
+     p(-2) = 2*(p(-1)+u2)-u0, and the same for q from v. */
+  bc_init_num (&p);
+  bc_init_num (&p1);
+  bc_init_num (&pm1);
+  bc_init_num (&pm2);
+  bc_init_num (&q);
+  bc_add (u0, u2, &p, 0);
+  bc_add (p, u1, &p1, 0);
+  bc_sub (p, u1, &pm1, 0);
+  bc_add (pm1, u2, &pm2, 0);
+  bc_add (pm2, pm2, &pm2, 0);
+  bc_sub (pm2, u0, &pm2, 0);
+  if (square)
+  {
+    q1 = bc_copy_num (p1);
+    qm1 = bc_copy_num (pm1);
+    qm2 = bc_copy_num (pm2);
+  }
+  else
+  {
+    bc_init_num (&q1);
+    bc_init_num (&qm1);
+    bc_init_num (&qm2);
+    bc_add (v0, v2, &q, 0);
+    bc_add (q, v1, &q1, 0);
+    bc_sub (q, v1, &qm1, 0);
+    bc_add (qm1, v2, &qm2, 0);
+    bc_add (qm2, qm2, &qm2, 0);
+    bc_sub (qm2, v0, &qm2, 0);
+  }
+
+  /* Pointwise multiplies. */
+  jobs[0].j_u = u0;
+  jobs[0].j_v = v0;
+  jobs[1].j_u = p1;
+  jobs[1].j_v = q1;
+  jobs[2].j_u = pm1;
+  jobs[2].j_v = qm1;
+  jobs[3].j_u = pm2;
+  jobs[3].j_v = qm2;
+  jobs[4].j_u = u2;
+  jobs[4].j_v = v2;
+  _bc_mul_jobs (jobs, 5, ulen + vlen);
+  w0 = _bc_toom_signed (&jobs[0]);
+  w1 = _bc_toom_signed (&jobs[1]);
+  wm1 = _bc_toom_signed (&jobs[2]);
+  wm2 = _bc_toom_signed (&jobs[3]);
+  winf = _bc_toom_signed (&jobs[4]);
+
+  /* Interpolate.  When done w0, w1, wm1, wm2 and winf hold the
+     coefficients of x^0 through x^4, all of them non negative. */
+  bc_init_num (&t);
+  bc_sub (wm2, w1, &wm2, 0);       /* w3 = (w(-2) - w(1)) / 3 */
+  _bc_toom_div (wm2, 3);
+  bc_sub (w1, wm1, &w1, 0);        /* w1 = (w(1) - w(-1)) / 2 */
+  _bc_toom_div (w1, 2);
+  bc_sub (wm1, w0, &wm1, 0);       /* w2 = w(-1) - w(0) */
+  bc_sub (wm1, wm2, &wm2, 0);      /* w3 = (w2 - w3) / 2 + 2*w(inf) */
+  _bc_toom_div (wm2, 2);
+  bc_add (winf, winf, &t, 0);
+  bc_add (wm2, t, &wm2, 0);
+  bc_add (wm1, w1, &wm1, 0);       /* w2 = w2 + w1 - w(inf) */
+  bc_sub (wm1, winf, &wm1, 0);
+  bc_sub (w1, wm2, &w1, 0);        /* w1 = w1 - w3 */
+  assert (w1->n_sign == PLUS && wm1->n_sign == PLUS && wm2->n_sign == PLUS);
+
+  /* Initialize product and add in the shifted coefficients. */
+  prodlen = ulen + vlen + 1;
+  *prod = bc_new_num (prodlen, 0);
+  _bc_shift_addsub (*prod, w0, 0, 0);
+  _bc_shift_addsub (*prod, w1, n, 0);
+  _bc_shift_addsub (*prod, wm1, 2 * n, 0);
+  _bc_shift_addsub (*prod, wm2, 3 * n, 0);
+  _bc_shift_addsub (*prod, winf, 4 * n, 0);
+
+  /* Now clean up! */
+  bc_free_num (&u0);
+  bc_free_num (&u1);
+  bc_free_num (&u2);
+  bc_free_num (&v0);
+  bc_free_num (&v1);
+  bc_free_num (&v2);
+  bc_free_num (&p);
+  bc_free_num (&p1);
+  bc_free_num (&pm1);
+  bc_free_num (&pm2);
+  bc_free_num (&q);
+  bc_free_num (&q1);
+  bc_free_num (&qm1);
+  bc_free_num (&qm2);
+  bc_free_num (&w0);
+  bc_free_num (&w1);
+  bc_free_num (&wm1);
+  bc_free_num (&wm2);
+  bc_free_num (&winf);
+  bc_free_num (&t);
+}
+
+/* Recursive divide and conquer multiply algorithm.
+   Based on
+   Let u = u0 + u1*(b^n)
+   Let v = v0 + v1*(b^n)
+   Then uv = (B^2n+B^n)*u1*v1 + B^n*(u1-u0)*(v0-v1) + (B^n+1)*u0*v0
+
+   B is the base of storage, number of digits in u1,u0 close to equal.
+   When u is v this is u*u = (B^2n+B^n)*u1*u1 - B^n*(u1-u0)^2
+   + (B^n+1)*u0*u0, three squares, and at the bottom _bc_simp_sqr.
+*/
+static void
+_bc_rec_mul (bc_num u, int ulen, bc_num v, int vlen, bc_num *prod)
+{
+  bc_num u0, u1, v0, v1;
+  bc_num m1, m2, m3, d1, d2;
+  bc_mul_job jobs[3];
+  int n, prodlen, m1zero, square;
+
+  square = (u == v && ulen == vlen);
+
+  /* Base case? */
+  if ((ulen + vlen) < mul_base_digits
+      || ulen < MUL_SMALL_DIGITS
+      || vlen < MUL_SMALL_DIGITS ) {
+    if (square)
+      _bc_simp_sqr (u, ulen, prod);
+    else
+      _bc_simp_mul (u, ulen, v, vlen, prod);
+    return;
+  }
+
+#if defined(BC_NTT)
+  /* NTT for very long operands, unless there are threads enough to
+     make splitting it up first pay. */
+  if ((ulen + vlen) >= mul_ntt_digits && _bc_ntt_fits (ulen, vlen)
+      && !_bc_fork_split (ulen + vlen)) {
+    _bc_ntt_mul (u, ulen, v, vlen, prod);
+    return;
+  }
+#endif
+
+  /* Toom-3 for long operands of about the same length. */
+  if ((ulen + vlen) >= mul_toom3_digits
+      && MIN(ulen, vlen) > 2 * ((MAX(ulen, vlen) + 2) / 3)) {
+    _bc_toom3_mul (u, ulen, v, vlen, prod);
+    return;
+  }
+
+  /* Calculate n -- the u and v split point in digits. */
+  n = (MAX(ulen, vlen) + 1) / 2;
+
+  /* Split u and v. */
+  if (ulen < n) {
+    u1 = bc_copy_num (_zero_);
+    u0 = new_sub_num (ulen, 0, u->n_value);
+  } else {
+    u1 = new_sub_num (ulen - n, 0, u->n_value);
+    u0 = new_sub_num (n, 0, u->n_value + ulen - n);
+  }
+  _bc_rm_leading_zeros (u1);
+  _bc_rm_leading_zeros (u0);
+  if (square) {
+    v1 = bc_copy_num (u1);
+    v0 = bc_copy_num (u0);
+  } else {
+    if (vlen < n) {
+      v1 = bc_copy_num (_zero_);
+      v0 = new_sub_num (vlen, 0, v->n_value);
+    } else {
+      v1 = new_sub_num (vlen - n, 0, v->n_value);
+      v0 = new_sub_num (n, 0, v->n_value + vlen - n);
+    }
+    _bc_rm_leading_zeros (v1);
+    _bc_rm_leading_zeros (v0);
+  }
+
+  m1zero = bc_is_zero(u1) || bc_is_zero(v1);
+
+  /* Calculate sub results ... */
+
+  bc_init_num(&d1);
+  bc_init_num(&d2);
+  bc_sub (u1, u0, &d1, 0);
+  if (square)
+  {
+    bc_free_num (&d2);
+    d2 = bc_copy_num (d1);
+  }
+  else
+    bc_sub (v0, v1, &d2, 0);
+
+
+  /* Do recursive multiplies and shifted adds. */
+  jobs[0].j_u = u1;
+  jobs[0].j_v = v1;
+  jobs[1].j_u = d1;
+  jobs[1].j_v = d2;
+  jobs[2].j_u = u0;
+  jobs[2].j_v = v0;
+  _bc_mul_jobs (jobs, 3, ulen + vlen);
+  m1 = jobs[0].j_prod;
+  m2 = jobs[1].j_prod;
+  m3 = jobs[2].j_prod;
+
+  /* Initialize product */
+  prodlen = ulen + vlen + 1;
+  *prod = bc_new_num(prodlen, 0);
+
+  if (!m1zero) {
+    _bc_shift_addsub (*prod, m1, 2 * n, 0);
+    _bc_shift_addsub (*prod, m1, n, 0);
+  }
+  _bc_shift_addsub (*prod, m3, n, 0);
+  _bc_shift_addsub (*prod, m3, 0, 0);
+  _bc_shift_addsub (*prod, m2, n, square || d1->n_sign != d2->n_sign);
+
+  /* Now clean up! */
+  bc_free_num (&u1);
+  bc_free_num (&u0);
+  bc_free_num (&v1);
+  bc_free_num (&m1);
+  bc_free_num (&v0);
+  bc_free_num (&m2);
+  bc_free_num (&m3);
+  bc_free_num (&d1);
+  bc_free_num (&d2);
+}
+
+/* The multiply routine.  N2 times N1 is put int PROD with the scale of
+   the result being MIN(N2 scale+N1 scale, MAX (SCALE, N2 scale, N1 scale)).
+*/
+
+void bc_multiply (bc_num n1, bc_num n2, bc_num *prod, int scale)
+{
+  bc_num pval;
+  int len1, len2;
+  int full_scale, prod_scale;
+
+  /* Initialize things. */
+  len1 = n1->n_len + n1->n_scale;
+  len2 = n2->n_len + n2->n_scale;
+  full_scale = n1->n_scale + n2->n_scale;
+  prod_scale = MIN(full_scale, MAX(scale, MAX(n1->n_scale, n2->n_scale)));
+
+  /* Do the multiply */
+  _bc_rec_mul (n1, len1, n2, len2, &pval);
+
+  /* Assign to prod and clean up the number. */
+  pval->n_sign = ( n1->n_sign == n2->n_sign ? PLUS : MINUS );
+  pval->n_value = pval->n_ptr;
+  pval->n_len = len2 + len1 + 1 - full_scale;
+  pval->n_scale = prod_scale;
+  _bc_rm_leading_zeros (pval);
+  if (bc_is_zero (pval))
+    pval->n_sign = PLUS;
+  bc_free_num (prod);
+  *prod = pval;
+}
+
+/* PROD = NUM * NUM, with the scale bc_multiply would give.  Every
+   multiply tier forms a square from about half the digit products of
+   a general multiply. */
+
+void bc_square (bc_num num, bc_num *prod, int scale)
+{
+  bc_multiply (num, num, prod, scale);
+}
+
+/* Some utility routines for the divide:  First a one digit multiply.
+   NUM (with SIZE digits) is multiplied by DIGIT and the result is
+   placed into RESULT.  It is written so that NUM and RESULT can be
+   the same pointers.  */
+
+static void _one_mult (unsigned char *num, int size, int digit, unsigned char *result)
+{
+  int carry, value;
+  unsigned char *nptr, *rptr;
+
+  if (digit == 0)
+    memset (result, 0, size);
+  else
+  {
+    if (digit == 1)
+      memcpy (result, num, size);
+    else
+    {
+      /* Initialize */
+      nptr = (unsigned char *) (num + size - 1);
+      rptr = (unsigned char *) (result + size - 1);
+      carry = 0;
+
+      while (size-- > 0)
+      {
+        value = *nptr-- * digit + carry;
+        *rptr-- = value % BASE;
+        carry = value / BASE;
+      }
+
+      if (carry != 0) *rptr = carry;
+    }
+  }
+}
+
+/* Newton reciprocal division.  Knuth's divide costs a one digit
+   multiply and subtract over the whole divisor for every quotient
+   digit.  For long divisors and quotients the quotient is instead found
+   as N * (1/D) with the reciprocal grown by Newton's iteration on top of
+   bc_multiply, so a divide costs a few multiplies.  That only beats
+   the Burnikel-Ziegler divide below once the NTT tier makes multiplies
+   close to linear.  From 30000 to 100000 digits the two trade places
+   as the NTT transform sizes step up (tools/testdiv can stop there);
+   from about 110000 digits on Newton stays ahead, mostly by 10-25%. */
+
+#if !defined(DIV_NEWTON_DIGITS)
+#if defined(BC_NTT)
+#define DIV_NEWTON_DIGITS 120000
+#else
+#define DIV_NEWTON_DIGITS INT_MAX  /* Burnikel-Ziegler always wins. */
+#endif
+#endif
+#define DIV_RECIP_DIGITS 32     /* Reciprocals this short use Knuth. */
+
+/* Return the integer NUM times 10^PLACES.  A negative PLACES drops
+   digits, truncating toward zero. */
+
+static bc_num _bc_shift_int (bc_num num, int places)
+{
+  bc_num result;
+  int len;
+
+  len = num->n_len + places;
+  if (len <= 0 || bc_is_zero (num))
+    return bc_copy_num (_zero_);
+  result = bc_new_num (len, 0);
+  result->n_sign = num->n_sign;
+  memcpy (result->n_value, num->n_value, MIN (len, num->n_len));
+  return result;
+}
+
+/* Return about 10^(2P) / Dp, where Dp is the integer D cut or padded
+   to P digits.  Each step takes the reciprocal at half the precision
+   and does one Newton step y = y + y * (10^(2P) - Dp * y) / 10^(2P),
+   which doubles the correct digits. */
+
+static bc_num _bc_newton_recip (bc_num d, int p)
+{
+  bc_num dp, power, y, t, e;
+  int h;
+
+  dp = _bc_shift_int (d, p - d->n_len);
+  power = _bc_shift_int (_one_, 2 * p);
+  if (p <= DIV_RECIP_DIGITS)
+  {
+    bc_init_num (&y);
+    bc_divide (power, dp, &y, 0);
+  }
+  else
+  {
+    h = (p + 1) / 2 + 1;
+    t = _bc_newton_recip (d, h);
+    y = _bc_shift_int (t, p - h);
+    bc_free_num (&t);
+    bc_init_num (&t);
+    bc_init_num (&e);
+    bc_multiply (dp, y, &t, 0);
+    bc_sub (power, t, &e, 0);
+    bc_multiply (y, e, &t, 0);
+    bc_free_num (&e);
+    e = _bc_shift_int (t, -2 * p);
+    bc_add (y, e, &y, 0);
+    bc_free_num (&t);
+    bc_free_num (&e);
+  }
+  bc_free_num (&dp);
+  bc_free_num (&power);
+  return y;
+}
+
+/* Return floor (N / D) for positive integers N and D.  The estimate
+   from the reciprocal is off by a few units at most; the remainder
+   check corrects it. */
+
+static bc_num _bc_newton_quotient (bc_num n, bc_num d)
+{
+  bc_num recip, q, t, rem;
+  int p;
+
+  if (bc_compare (n, d) < 0)
+    return bc_copy_num (_zero_);
+  p = n->n_len - d->n_len + 2;
+  recip = _bc_newton_recip (d, p);
+  bc_init_num (&t);
+  bc_multiply (n, recip, &t, 0);
+  q = _bc_shift_int (t, -(p + d->n_len));
+
+  bc_init_num (&rem);
+  bc_multiply (q, d, &t, 0);
+  bc_sub (n, t, &rem, 0);
+  while (bc_is_neg (rem))
+  {
+    bc_sub (q, _one_, &q, 0);
+    bc_add (rem, d, &rem, 0);
+  }
+  while (bc_compare (rem, d) >= 0)
+  {
+    bc_add (q, _one_, &q, 0);
+    bc_sub (rem, d, &rem, 0);
+  }
+
+  bc_free_num (&recip);
+  bc_free_num (&t);
+  bc_free_num (&rem);
+  return q;
+}
+
+/* Burnikel-Ziegler recursive division.  A 2n by n digit divide is done
+   as two 3n/2 by n divides, and each of those as an n by n/2 divide
+   (the recursion) plus one n/2 by n/2 multiply through _bc_rec_mul.
+   The divisor is first padded to n = m * 2^k digits with m at most
+   DIV_BZ_LEAF, where the recursion ends in Knuth's divide, and
+   normalized so its first digit is 5 or more; that keeps each quotient
+   estimate within two of the truth.  A long dividend is divided n
+   digits at a time. */
+
+#if !defined(DIV_BZ_DIGITS)
+#define DIV_BZ_DIGITS 40
+#endif
+#define DIV_BZ_LEAF 32          /* Divisors this short use Knuth. */
+
+/* Return floor (NUM / 10^LOW) mod 10^(HIGH - LOW) for the non negative
+   integer NUM. */
+
+static bc_num _bc_int_digits (bc_num num, int high, int low)
+{
+  bc_num result;
+  int start, end;
+
+  start = MAX (0, num->n_len - high);
+  end = num->n_len - low;
+  if (end <= start)
+    return bc_copy_num (_zero_);
+  result = bc_new_num (end - start, 0);
+  memcpy (result->n_value, num->n_value + start, end - start);
+  _bc_rm_leading_zeros (result);
+  return result;
+}
+
+static void _bc_bz_div2n1n (bc_num a, bc_num b, int n, bc_num *quot,
+                            bc_num *rem);
+
+/* Divide [A12 A3] by B = [B1 B2], where A3, B1 and B2 have H digits
+   and A12 < B * 10^H. */
+
+static void _bc_bz_div3n2n (bc_num a12, bc_num a3, bc_num b, bc_num b1,
+                            bc_num b2, int h, bc_num *quot, bc_num *rem)
+{
+  bc_num a1, qhat, r1, t;
+
+  bc_init_num (&qhat);
+  bc_init_num (&r1);
+  bc_init_num (&t);
+  a1 = _bc_int_digits (a12, 2 * h, h);
+  if (bc_compare (a1, b1) < 0)
+    _bc_bz_div2n1n (a12, b1, h, &qhat, &r1);
+  else
+  {
+    /* qhat = 10^h - 1, r1 = a12 - qhat * b1 = a12 - b1 * 10^h + b1. */
+    bc_free_num (&qhat);
+    bc_free_num (&t);
+    t = _bc_shift_int (_one_, h);
+    bc_sub (t, _one_, &qhat, 0);
+    bc_free_num (&t);
+    t = _bc_shift_int (b1, h);
+    bc_sub (a12, t, &r1, 0);
+    bc_add (r1, b1, &r1, 0);
+  }
+  bc_free_num (&a1);
+
+  /* rhat = r1 * 10^h + a3 - qhat * b2, fixed up to be non negative. */
+  bc_free_num (&t);
+  t = _bc_shift_int (r1, h);
+  bc_add (t, a3, &r1, 0);
+  bc_multiply (qhat, b2, &t, 0);
+  bc_sub (r1, t, &r1, 0);
+  while (bc_is_neg (r1))
+  {
+    bc_sub (qhat, _one_, &qhat, 0);
+    bc_add (r1, b, &r1, 0);
+  }
+  bc_free_num (&t);
+  bc_free_num (quot);
+  bc_free_num (rem);
+  *quot = qhat;
+  *rem = r1;
+}
+
+/* Divide A by the N digit, normalized B, where A < B * 10^N. */
+
+static void _bc_bz_div2n1n (bc_num a, bc_num b, int n, bc_num *quot,
+                            bc_num *rem)
+{
+  bc_num b1, b2, a12, a3, a4, q1, q2, r, t;
+  int h;
+
+  if (n % 2 != 0 || n <= DIV_BZ_LEAF)
+  {
+    bc_init_num (&t);
+    bc_divide (a, b, quot, 0);
+    bc_multiply (*quot, b, &t, 0);
+    bc_sub (a, t, rem, 0);
+    bc_free_num (&t);
+    return;
+  }
+
+  h = n / 2;
+  b1 = _bc_int_digits (b, n, h);
+  b2 = _bc_int_digits (b, h, 0);
+  a12 = _bc_int_digits (a, 2 * n, n);
+  a3 = _bc_int_digits (a, n, h);
+  a4 = _bc_int_digits (a, h, 0);
+  bc_init_num (&q1);
+  bc_init_num (&q2);
+  bc_init_num (&r);
+  _bc_bz_div3n2n (a12, a3, b, b1, b2, h, &q1, &r);
+  _bc_bz_div3n2n (r, a4, b, b1, b2, h, &q2, rem);
+
+  /* quot = q1 * 10^h + q2. */
+  t = _bc_shift_int (q1, h);
+  bc_add (t, q2, quot, 0);
+
+  bc_free_num (&b1);
+  bc_free_num (&b2);
+  bc_free_num (&a12);
+  bc_free_num (&a3);
+  bc_free_num (&a4);
+  bc_free_num (&q1);
+  bc_free_num (&q2);
+  bc_free_num (&r);
+  bc_free_num (&t);
+}
+
+/* Return floor (N / D) for positive integers N and D, by Burnikel and
+   Ziegler. */
+
+static bc_num _bc_bz_quotient (bc_num n, bc_num d)
+{
+  bc_num b, a, r, block, qi, t, q;
+  int blocks, size, top, indx, qlen;
+  char *qptr;
+
+  /* Pad the divisor to size = m * 2^k digits, m <= DIV_BZ_LEAF, and
+     normalize it; scaling both operands leaves the quotient alone. */
+  for (blocks = 1; (d->n_len + blocks - 1) / blocks > DIV_BZ_LEAF;
+       blocks *= 2)
+    ;
+  size = (d->n_len + blocks - 1) / blocks * blocks;
+  bc_init_num (&t);
+  bc_int2num (&t, BASE / (*d->n_value + 1));
+  bc_init_num (&b);
+  bc_init_num (&a);
+  bc_multiply (d, t, &b, 0);
+  bc_multiply (n, t, &a, 0);
+  bc_free_num (&t);
+  t = _bc_shift_int (b, size - d->n_len);
+  bc_free_num (&b);
+  b = t;
+  t = _bc_shift_int (a, size - d->n_len);
+  bc_free_num (&a);
+  a = t;
+
+  /* Divide A one block of SIZE digits at a time, starting with the
+     top block if it is below B and with a zero block if it is not. */
+  top = (a->n_len + size - 1) / size;
+  r = _bc_int_digits (a, top * size, (top - 1) * size);
+  if (bc_compare (r, b) >= 0)
+  {
+    bc_free_num (&r);
+    r = bc_copy_num (_zero_);
+    top++;
+  }
+  qlen = (top - 1) * size;
+  q = bc_new_num (MAX (qlen, 1), 0);
+  qptr = q->n_value;
+  bc_init_num (&qi);
+  for (indx = top - 2; indx >= 0; indx--)
+  {
+    block = _bc_int_digits (a, (indx + 1) * size, indx * size);
+    t = _bc_shift_int (r, size);
+    bc_add (t, block, &t, 0);
+    _bc_bz_div2n1n (t, b, size, &qi, &r);
+    if (!bc_is_zero (qi))
+      memcpy (qptr + size - qi->n_len, qi->n_value, qi->n_len);
+    qptr += size;
+    bc_free_num (&block);
+    bc_free_num (&t);
+  }
+  _bc_rm_leading_zeros (q);
+
+  bc_free_num (&a);
+  bc_free_num (&b);
+  bc_free_num (&r);
+  bc_free_num (&qi);
+  return q;
+}
+
+/* Do N1 / N2 for bc_divide, with the same result, by Newton's method
+   if the divisor and the quotient are both at least div_newton_digits
+   long, or else by Burnikel and Ziegler if they are both at least
+   div_bz_digits long.  Returns FALSE, doing nothing, if they are not. */
+
+static int _bc_long_divide (bc_num n1, bc_num n2, bc_num *quot, int scale)
+{
+  bc_num n, d, q, qval;
+  char *n2ptr;
+  int scale2, len2, nlen, ndigits, qlen, newton;
+
+  /* The divisor as an integer: drop the zeros at both ends. */
+  scale2 = n2->n_scale;
+  n2ptr = n2->n_value + n2->n_len + scale2 - 1;
+  while ((scale2 > 0) && (*n2ptr-- == 0)) scale2--;
+  n2ptr = n2->n_value;
+  len2 = n2->n_len + scale2;
+  while (*n2ptr == 0)
+  {
+    n2ptr++;
+    len2--;
+  }
+
+  /* The dividend as an integer, times 10^(scale + scale2). */
+  nlen = n1->n_len + scale + scale2;
+  if (len2 >= div_newton_digits && len2 > DIV_RECIP_DIGITS
+      && nlen - len2 + 1 >= div_newton_digits)
+    newton = TRUE;
+  else if (len2 >= div_bz_digits && len2 > DIV_BZ_LEAF
+           && nlen - len2 + 1 >= div_bz_digits)
+    newton = FALSE;
+  else
+    return FALSE;
+
+  d = bc_new_num (len2, 0);
+  memcpy (d->n_value, n2ptr, len2);
+  n = bc_new_num (nlen, 0);
+  ndigits = MIN (nlen, n1->n_len + n1->n_scale);
+  memcpy (n->n_value, n1->n_value, ndigits);
+  _bc_rm_leading_zeros (n);
+
+  if (newton)
+    q = _bc_newton_quotient (n, d);
+  else
+    q = _bc_bz_quotient (n, d);
+
+  /* Put the decimal point back: q has scale digits of fraction. */
+  qlen = q->n_len;
+  if (bc_is_zero (q))
+    qlen = 0;
+  qval = bc_new_num (MAX (qlen - scale, 1), scale);
+  memcpy (qval->n_value + MAX (qlen - scale, 1) + scale - qlen,
+          q->n_value, qlen);
+  qval->n_sign = (n1->n_sign == n2->n_sign ? PLUS : MINUS);
+  if (bc_is_zero (qval)) qval->n_sign = PLUS;
+  bc_free_num (quot);
+  *quot = qval;
+
+  bc_free_num (&n);
+  bc_free_num (&d);
+  bc_free_num (&q);
+  return TRUE;
+}
+
+
+/* The full division routine. This computes N1 / N2.  It returns
+   0 if the division is ok and the result is in QUOT.  The number of
+   digits after the decimal point is SCALE. It returns -1 if division
+   by zero is tried.  The algorithm is found in Knuth Vol 2. p237. */
+
+int bc_divide (bc_num n1, bc_num n2, bc_num *quot, int scale)
+{
+  bc_num qval;
+  unsigned char *num1, *num2;
+  unsigned char *ptr1, *ptr2, *n2ptr, *qptr;
+  int  scale1, val;
+  unsigned int  len1, len2, scale2, qdigits, extra, count;
+  unsigned int  qdig, qguess, borrow, carry;
+  unsigned char *mval;
+  char zero;
+  unsigned int  norm;
+
+  /* Test for divide by zero. */
+  if (bc_is_zero (n2)) return -1;
+
+  /* Test for divide by 1.  If it is we must truncate. */
+  if (n2->n_scale == 0)
+  {
+    if (n2->n_len == 1 && *n2->n_value == 1)
+    {
+      qval = bc_new_num (n1->n_len, scale);
+      qval->n_sign = (n1->n_sign == n2->n_sign ? PLUS : MINUS);
+      memset (&qval->n_value[n1->n_len], 0, scale);
+      memcpy (qval->n_value, n1->n_value,
+              n1->n_len + MIN(n1->n_scale, scale));
+      bc_free_num (quot);
+      *quot = qval;
+    }
+  }
+
+  /* Long divisions go to the Newton divide. */
+  if (_bc_long_divide (n1, n2, quot, scale))
+    return 0;
+
+  /* Set up the divide.  Move the decimal point on n1 by n2's scale.
+     Remember, zeros on the end of num2 are wasted effort for dividing. */
+  scale2 = n2->n_scale;
+  n2ptr = (unsigned char *) n2->n_value + n2->n_len + scale2 - 1;
+  while ((scale2 > 0) && (*n2ptr-- == 0)) scale2--;
+
+  len1 = n1->n_len + scale2;
+  scale1 = n1->n_scale - scale2;
+  if (scale1 < scale)
+    extra = scale - scale1;
+  else
+    extra = 0;
+  num1 = (unsigned char *) malloc (n1->n_len + n1->n_scale + extra + 2);
+  if (num1 == NULL) bc_out_of_memory();
+  memset (num1, 0, n1->n_len + n1->n_scale + extra + 2);
+  memcpy (num1 + 1, n1->n_value, n1->n_len + n1->n_scale);
+
+  len2 = n2->n_len + scale2;
+  num2 = (unsigned char *) malloc (len2 + 1);
+  if (num2 == NULL) bc_out_of_memory();
+  memcpy (num2, n2->n_value, len2);
+  *(num2 + len2) = 0;
+  n2ptr = num2;
+  while (*n2ptr == 0)
+  {
+    n2ptr++;
+    len2--;
+  }
+
+  /* Calculate the number of quotient digits. */
+  if (len2 > len1 + scale)
+  {
+    qdigits = scale + 1;
+    zero = TRUE;
+  }
+  else
+  {
+    zero = FALSE;
+    if (len2 > len1)
+      qdigits = scale + 1;    /* One for the zero integer part. */
+    else
+      qdigits = len1 - len2 + scale + 1;
+  }
+
+  /* Allocate and zero the storage for the quotient. */
+  qval = bc_new_num (qdigits - scale, scale);
+  memset (qval->n_value, 0, qdigits);
+
+  /* Allocate storage for the temporary storage mval. */
+  mval = (unsigned char *) malloc (len2 + 1);
+  if (mval == NULL) bc_out_of_memory ();
+
+  /* Now for the full divide algorithm. */
+  if (!zero)
+  {
+    /* Normalize */
+    norm =  10 / ((int) * n2ptr + 1);
+    if (norm != 1)
+    {
+      _one_mult (num1, len1 + scale1 + extra + 1, norm, num1);
+      _one_mult (n2ptr, len2, norm, n2ptr);
+    }
+
+    /* Initialize divide loop. */
+    qdig = 0;
+    if (len2 > len1)
+      qptr = (unsigned char *) qval->n_value + len2 - len1;
+    else
+      qptr = (unsigned char *) qval->n_value;
+
+    /* Loop */
+    while (qdig <= len1 + scale - len2)
+    {
+      /* Calculate the quotient digit guess. */
+      if (*n2ptr == num1[qdig])
+        qguess = 9;
+      else
+        qguess = (num1[qdig] * 10 + num1[qdig + 1]) / *n2ptr;
+
+      /* Test qguess. */
+      if (n2ptr[1]*qguess >
+          (num1[qdig] * 10 + num1[qdig + 1] - *n2ptr * qguess) * 10
+          + num1[qdig + 2])
+      {
+        qguess--;
+        /* And again. */
+        if (n2ptr[1]*qguess >
+            (num1[qdig] * 10 + num1[qdig + 1] - *n2ptr * qguess) * 10
+            + num1[qdig + 2])
+          qguess--;
+      }
+
+      /* Multiply and subtract. */
+      borrow = 0;
+      if (qguess != 0)
+      {
+        *mval = 0;
+        _one_mult (n2ptr, len2, qguess, mval + 1);
+        ptr1 = (unsigned char *) num1 + qdig + len2;
+        ptr2 = (unsigned char *) mval + len2;
+        for (count = 0; count < len2 + 1; count++)
+        {
+          val = (int) * ptr1 - (int) * ptr2-- - borrow;
+          if (val < 0)
+          {
+            val += 10;
+            borrow = 1;
+          }
+          else
+            borrow = 0;
+          *ptr1-- = val;
+        }
+      }
+
+      /* Test for negative result. */
+      if (borrow == 1)
+      {
+        qguess--;
+        ptr1 = (unsigned char *) num1 + qdig + len2;
+        ptr2 = (unsigned char *) n2ptr + len2 - 1;
+        carry = 0;
+        for (count = 0; count < len2; count++)
+        {
+          val = (int) * ptr1 + (int) * ptr2-- + carry;
+          if (val > 9)
+          {
+            val -= 10;
+            carry = 1;
+          }
+          else
+            carry = 0;
+          *ptr1-- = val;
+        }
+        if (carry == 1) *ptr1 = (*ptr1 + 1) % 10;
+      }
+
+      /* We now know the quotient digit. */
+      *qptr++ =  qguess;
+      qdig++;
+    }
+  }
+
+  /* Clean up and return the number. */
+  qval->n_sign = ( n1->n_sign == n2->n_sign ? PLUS : MINUS );
+  if (bc_is_zero (qval)) qval->n_sign = PLUS;
+  _bc_rm_leading_zeros (qval);
+  bc_free_num (quot);
+  *quot = qval;
+
+  /* Clean up temporary storage. */
+  free (mval);
+  free (num1);
+  free (num2);
+
+  return 0;     /* Everything is OK. */
+}
+
+
+/* Division *and* modulo for numbers.  This computes both NUM1 / NUM2 and
+   NUM1 % NUM2  and puts the results in QUOT and REM, except that if QUOT
+   is NULL then that store will be omitted.
+*/
+
+int bc_divmod (bc_num num1, bc_num num2, bc_num *quot, bc_num *rem, int scale)
+{
+  bc_num quotient = NULL;
+  bc_num temp;
+  int rscale;
+
+  /* Check for correct numbers. */
+  if (bc_is_zero (num2)) return -1;
+
+  /* Calculate final scale. */
+  rscale = MAX (num1->n_scale, num2->n_scale + scale);
+  bc_init_num(&temp);
+
+  /* Calculate it. */
+  bc_divide (num1, num2, &temp, scale);
+  if (quot)
+    quotient = bc_copy_num (temp);
+  bc_multiply (temp, num2, &temp, rscale);
+  bc_sub (num1, temp, rem, rscale);
+  bc_free_num (&temp);
+
+  if (quot)
+  {
+    bc_free_num (quot);
+    *quot = quotient;
+  }
+
+  return 0;     /* Everything is OK. */
+}
+
+
+/* Modulo for numbers.  This computes NUM1 % NUM2  and puts the
+   result in RESULT.   */
+
+int bc_modulo (bc_num num1, bc_num num2, bc_num *result, int scale)
+{
+  return bc_divmod (num1, num2, NULL, result, scale);
+}
+
+/* Modular arithmetic with a prepared modulus, for bc_raisemod and for
+   callers doing many operations with one modulus.  A product of two
+   reduced numbers is reduced by Barrett's method: with the K digit
+   modulus m and mu = floor (10^(2K) / m), any x < 10^(2K) has
+   x mod m = x - floor (floor (x / 10^(K-1)) * mu / 10^(K+1)) * m,
+   give or take two more subtractions of m.  So two multiplies, which
+   take the faster multiply tiers, replace each divide; that is faster
+   than bc_modulo from two digit moduli up. */
+
+#define MOD_WINDOW_MAX 6        /* Largest exponent window, in bits. */
+
+/* Set up CTX for reductions modulo the integer part of MOD.  Returns
+   -1, leaving nothing to free, if that is zero. */
+
+int bc_init_modctx (bc_modctx *ctx, bc_num mod)
+{
+  bc_num power;
+
+  ctx->m_mod = NULL;
+  ctx->m_mu = NULL;
+  bc_init_num (&ctx->m_mod);
+  bc_divide (mod, _one_, &ctx->m_mod, 0);
+  if (bc_is_zero (ctx->m_mod))
+  {
+    bc_free_num (&ctx->m_mod);
+    return -1;
+  }
+  ctx->m_mod->n_sign = PLUS;
+  ctx->m_len = ctx->m_mod->n_len;
+
+  power = _bc_shift_int (_one_, 2 * ctx->m_len);
+  bc_init_num (&ctx->m_mu);
+  bc_divide (power, ctx->m_mod, &ctx->m_mu, 0);
+  bc_free_num (&power);
+  return 0;
+}
+
+/* Free what bc_init_modctx set up. */
+
+void bc_free_modctx (bc_modctx *ctx)
+{
+  bc_free_num (&ctx->m_mod);
+  bc_free_num (&ctx->m_mu);
+}
+
+/* RESULT = X mod the modulus of CTX, for the non negative integer X.
+   Barrett only covers X below 10^(2K); bc_modulo does the rest. */
+
+static void _bc_modctx_reduce (bc_modctx *ctx, bc_num x, bc_num *result)
+{
+  bc_num q, t;
+
+  if (x->n_len > 2 * ctx->m_len)
+  {
+    (void) bc_modulo (x, ctx->m_mod, result, 0);
+    return;
+  }
+
+  q = _bc_shift_int (x, 1 - ctx->m_len);
+  bc_multiply (q, ctx->m_mu, &q, 0);
+  t = _bc_shift_int (q, -(ctx->m_len + 1));
+  bc_multiply (t, ctx->m_mod, &t, 0);
+  bc_sub (x, t, result, 0);
+  while (bc_compare (*result, ctx->m_mod) >= 0)
+    bc_sub (*result, ctx->m_mod, result, 0);
+  bc_free_num (&q);
+  bc_free_num (&t);
+}
+
+/* The integer part of NUM, without its sign, and whether it was
+   negative. */
+
+static bc_num _bc_modctx_magnitude (bc_num num, int *neg)
+{
+  bc_num mag;
+
+  bc_init_num (&mag);
+  bc_divide (num, _one_, &mag, 0);
+  *neg = (mag->n_sign == MINUS);
+  mag->n_sign = PLUS;
+  return mag;
+}
+
+/* RESULT = NUM mod the modulus of CTX, with the sign of NUM, as
+   bc_modulo gives for integers.  The fraction of NUM is dropped. */
+
+void bc_modctx_reduce (bc_modctx *ctx, bc_num num, bc_num *result)
+{
+  bc_num mag;
+  int neg;
+
+  mag = _bc_modctx_magnitude (num, &neg);
+  _bc_modctx_reduce (ctx, mag, &mag);
+  if (neg && !bc_is_zero (mag))
+    bc_sub (_zero_, mag, &mag, 0);
+  bc_free_num (result);
+  *result = mag;
+}
+
+/* RESULT = N1 * N2 mod the modulus of CTX, as bc_modctx_reduce. */
+
+void bc_modctx_multiply (bc_modctx *ctx, bc_num n1, bc_num n2,
+                         bc_num *result)
+{
+  bc_num prod;
+
+  bc_init_num (&prod);
+  bc_multiply (n1, n2, &prod, 0);
+  bc_modctx_reduce (ctx, prod, result);
+  bc_free_num (&prod);
+}
+
+/* Put the integer part of EXPO in binary, 16 bits to a word, least
+   significant word first, into a new array at *WORDS.  Returns the
+   number of bits. */
+
+static int _bc_expo_bits (bc_num expo, unsigned int **words)
+{
+  unsigned long value, carry;
+  char *nptr;
+  int nwords, indx, count, bits;
+
+  /* log2 (10) is below 4, so 4 digits never need more than a word. */
+  *words = (unsigned int *) malloc ((expo->n_len / 4 + 1)
+                                    * sizeof (unsigned int));
+  if (*words == NULL) bc_out_of_memory();
+
+  nwords = 0;
+  nptr = expo->n_value;
+  for (count = expo->n_len; count > 0; count--)
+  {
+    carry = *nptr++;
+    for (indx = 0; indx < nwords; indx++)
+    {
+      value = (unsigned long) (*words)[indx] * BASE + carry;
+      (*words)[indx] = value & 0xFFFF;
+      carry = value >> 16;
+    }
+    if (carry != 0)
+      (*words)[nwords++] = carry;
+  }
+
+  if (nwords == 0)
+    return 0;
+  bits = 16 * (nwords - 1);
+  for (value = (*words)[nwords - 1]; value != 0; value >>= 1)
+    bits++;
+  return bits;
+}
+
+#define EXPO_BIT(words, bit) (((words)[(bit) >> 4] >> ((bit) & 15)) & 1)
+
+/* RESULT = BASE^EXPO mod the modulus of CTX, by a left to right sliding
+   window over the bits of EXPO: runs of up to WINDOW bits that start
+   and end with a one take one multiply by a table of odd powers, every
+   bit takes one square.  This gives what bc_raisemod does for integers
+   and a zero scale; the fractions of BASE and EXPO are dropped.  Returns
+   -1, doing nothing, if EXPO is negative. */
+
+int bc_modctx_raise (bc_modctx *ctx, bc_num base, bc_num expo,
+                     bc_num *result)
+{
+  bc_num table[1 << (MOD_WINDOW_MAX - 1)];
+  bc_num power, square;
+  unsigned int *words;
+  int bits, window, neg, indx, low, value, count;
+
+  if (bc_is_neg (expo)) return -1;
+
+  bits = _bc_expo_bits (expo, &words);
+  if (bits == 0)
+  {
+    free (words);
+    bc_free_num (result);
+    *result = bc_copy_num (_one_);
+    return 0;
+  }
+
+  if (bits <= 8)
+    window = 1;
+  else if (bits <= 24)
+    window = 2;
+  else if (bits <= 80)
+    window = 3;
+  else if (bits <= 240)
+    window = 4;
+  else if (bits <= 672)
+    window = 5;
+  else
+    window = 6;
+
+  /* table[i] = base^(2i+1). */
+  table[0] = _bc_modctx_magnitude (base, &neg);
+  _bc_modctx_reduce (ctx, table[0], &table[0]);
+  count = 1 << (window - 1);
+  if (count > 1)
+  {
+    bc_init_num (&square);
+    bc_square (table[0], &square, 0);
+    _bc_modctx_reduce (ctx, square, &square);
+    for (indx = 1; indx < count; indx++)
+    {
+      bc_init_num (&table[indx]);
+      bc_multiply (table[indx - 1], square, &table[indx], 0);
+      _bc_modctx_reduce (ctx, table[indx], &table[indx]);
+    }
+    bc_free_num (&square);
+  }
+
+  power = NULL;
+  indx = bits - 1;
+  while (indx >= 0)
+  {
+    if (!EXPO_BIT (words, indx))
+    {
+      bc_square (power, &power, 0);
+      _bc_modctx_reduce (ctx, power, &power);
+      indx--;
+      continue;
+    }
+
+    /* The longest window from this one bit down to a one bit. */
+    low = MAX (indx - window + 1, 0);
+    while (!EXPO_BIT (words, low))
+      low++;
+    value = 0;
+    for (count = indx; count >= low; count--)
+      value = 2 * value + EXPO_BIT (words, count);
+
+    if (power == NULL)
+      power = bc_copy_num (table[value / 2]);
+    else
+    {
+      for (count = indx; count >= low; count--)
+      {
+        bc_square (power, &power, 0);
+        _bc_modctx_reduce (ctx, power, &power);
+      }
+      bc_multiply (power, table[value / 2], &power, 0);
+      _bc_modctx_reduce (ctx, power, &power);
+    }
+    indx = low - 1;
+  }
+
+  /* An odd power of a negative base is negative. */
+  if (neg && (expo->n_value[expo->n_len - 1] & 1) && !bc_is_zero (power))
+    bc_sub (_zero_, power, &power, 0);
+
+  for (indx = 0; indx < (1 << (window - 1)); indx++)
+    bc_free_num (&table[indx]);
+  free (words);
+  bc_free_num (result);
+  *result = power;
+  return 0;
+}
+
+/* Raise BASE to the EXPO power, reduced modulo MOD.  The result is
+   placed in RESULT.  If a EXPO is not an integer,
+   only the integer part is used.  Integers at a zero scale, which is
+   the usual case, go to bc_modctx_raise. */
+
+int bc_raisemod (bc_num base, bc_num expo, bc_num mod, bc_num *result, int scale)
+{
+  bc_num power, exponent, parity, temp;
+  bc_modctx ctx;
+  int rscale;
+
+  /* Check for correct numbers. */
+  if (bc_is_zero(mod)) return -1;
+  if (bc_is_neg(expo)) return -1;
+
+  /* Set initial values.  */
+  power = bc_copy_num (base);
+  exponent = bc_copy_num (expo);
+  temp = bc_copy_num (_one_);
+  bc_init_num(&parity);
+
+  /* Check the base for scale digits. */
+  if (base->n_scale != 0)
+    bc_rt_warn (BC_WARNING_NON_ZERO_SCALE_IN_BASE);
+
+  /* Check the exponent for scale digits. */
+  if (exponent->n_scale != 0)
+  {
+    bc_rt_warn (BC_WARNING_NON_ZERO_SCALE_IN_EXPONENT);
+    bc_divide (exponent, _one_, &exponent, 0); /*truncate */
+  }
+
+  /* Check the modulus for scale digits. */
+  if (mod->n_scale != 0)
+    bc_rt_warn (BC_WARNING_NON_ZERO_SCALE_IN_MODULUS);
+
+  if (base->n_scale == 0 && mod->n_scale == 0 && scale == 0)
+  {
+    (void) bc_init_modctx (&ctx, mod);
+    (void) bc_modctx_raise (&ctx, base, exponent, result);
+    bc_free_modctx (&ctx);
+    bc_free_num (&power);
+    bc_free_num (&exponent);
+    bc_free_num (&temp);
+    bc_free_num (&parity);
+    return 0;
+  }
+
+  /* Do the calculation. */
+  rscale = MAX(scale, base->n_scale);
+  while ( !bc_is_zero(exponent) )
+  {
+    (void) bc_divmod (exponent, _two_, &exponent, &parity, 0);
+    if ( !bc_is_zero(parity) )
+    {
+      bc_multiply (temp, power, &temp, rscale);
+      (void) bc_modulo (temp, mod, &temp, scale);
+    }
+
+    bc_square (power, &power, rscale);
+    (void) bc_modulo (power, mod, &power, scale);
+  }
+
+  /* Assign the value. */
+  bc_free_num (&power);
+  bc_free_num (&exponent);
+  bc_free_num (result);
+  bc_free_num (&parity);
+  *result = temp;
+  return 0;     /* Everything is OK. */
+}
+
+/* Raise NUM1 to the NUM2 power.  The result is placed in RESULT.
+   Maximum exponent is LONG_MAX.  If a NUM2 is not an integer,
+   only the integer part is used.  */
+
+void bc_raise (bc_num num1, bc_num num2, bc_num *result, int scale)
+{
+  bc_num temp, power;
+  long exponent;
+  int rscale;
+  int pwrscale;
+  int calcscale;
+  char neg;
+
+  /* Check the exponent for scale digits and convert to a long. */
+  if (num2->n_scale != 0)
+    bc_rt_warn (BC_WARNING_NON_ZERO_SCALE_IN_EXPONENT);
+  exponent = bc_num2long (num2);
+  if (exponent == 0 && (num2->n_len > 1 || num2->n_value[0] != 0))
+    bc_rt_error (BC_ERROR_EXPONENT_TOO_LARGE_IN_RAISE);
+
+  /* Special case if exponent is a zero. */
+  if (exponent == 0)
+  {
+    bc_free_num (result);
+    *result = bc_copy_num (_one_);
+    return;
+  }
+
+  /* Other initializations. */
+  if (exponent < 0)
+  {
+    neg = TRUE;
+    exponent = -exponent;
+    rscale = scale;
+  }
+  else
+  {
+    neg = FALSE;
+    rscale = MIN (num1->n_scale * exponent, MAX(scale, num1->n_scale));
+  }
+
+  /* Set initial value of temp.  */
+  power = bc_copy_num (num1);
+  pwrscale = num1->n_scale;
+  while ((exponent & 1) == 0)
+  {
+    pwrscale = 2 * pwrscale;
+    bc_square (power, &power, pwrscale);
+    exponent = exponent >> 1;
+  }
+  temp = bc_copy_num (power);
+  calcscale = pwrscale;
+  exponent = exponent >> 1;
+
+  /* Do the calculation. */
+  while (exponent > 0)
+  {
+    pwrscale = 2 * pwrscale;
+    bc_square (power, &power, pwrscale);
+    if ((exponent & 1) == 1) {
+      calcscale = pwrscale + calcscale;
+      bc_multiply (temp, power, &temp, calcscale);
+    }
+    exponent = exponent >> 1;
+  }
+
+  /* Assign the value. */
+  if (neg)
+  {
+    bc_divide (_one_, temp, result, rscale);
+    bc_free_num (&temp);
+  }
+  else
+  {
+    bc_free_num (result);
+    *result = temp;
+    if ((*result)->n_scale > rscale)
+      (*result)->n_scale = rscale;
+  }
+  bc_free_num (&power);
+}
+
+/* Square root by Newton's iteration for the reciprocal square root,
+   y = y + y * (1 - x * y^2) / 2, which takes only multiplies.  With
+   NUM * 10^(2 * rscale) = x * 10^(2h) and 0.01 <= x < 1, y is grown
+   from a few digits to about h, taking each step at twice the digits
+   of the one before, so all the steps together cost about as much as
+   the last.  Then x * y is about sqrt (x), and its first h digits
+   after the decimal point are floor (sqrt (NUM) * 10^rscale), give or
+   take a little that one square and a compare put right. */
+
+#define SQRT_START_DIGITS 4     /* Digits of x the first guess uses. */
+
+/* Return floor (sqrt (VAL)). */
+
+static unsigned long _bc_sqrt_ulong (unsigned long val)
+{
+  unsigned long root, next;
+
+  if (val < 2)
+    return val;
+  root = val;
+  next = (root + 1) / 2;
+  while (next < root)
+  {
+    root = next;
+    next = (root + val / root) / 2;
+  }
+  return root;
+}
+
+/* Take the square root NUM and return it in NUM with SCALE digits
+   after the decimal place. */
+
+int bc_sqrt (bc_num *num, int scale)
+{
+  int rscale, cmp_res;
+  int nlen, half, prec, steps, indx;
+  int precs[sizeof (int) * CHAR_BIT];
+  unsigned long start;
+  bc_num n, x, xp, y, t, e, root, diff;
+  char *xptr;
+
+  /* Initial checks. */
+  cmp_res = bc_compare (*num, _zero_);
+  if (cmp_res < 0)
+    return 0;           /* error */
+  else
+  {
+    if (cmp_res == 0)
+    {
+      bc_free_num (num);
+      *num = bc_copy_num (_zero_);
+      return 1;
+    }
+  }
+  cmp_res = bc_compare (*num, _one_);
+  if (cmp_res == 0)
+  {
+    bc_free_num (num);
+    *num = bc_copy_num (_one_);
+    return 1;
   }
 
-  /* Calculate n -- the u and v split point in digits. */
-  n = (MAX(ulen, vlen) + 1) / 2;
+  /* N = NUM * 10^(2 * rscale), an integer, and x = N / 10^(2h). */
+  rscale = MAX (scale, (*num)->n_scale);
+  nlen = (*num)->n_len + (*num)->n_scale;
+  n = bc_new_num (nlen + 2 * rscale - (*num)->n_scale, 0);
+  memcpy (n->n_value, (*num)->n_value, nlen);
+  _bc_rm_leading_zeros (n);
+  half = (n->n_len + 1) / 2;
+  x = bc_new_num (1, 2 * half);
+  xptr = x->n_value + 1 + 2 * half - n->n_len;
+  memcpy (xptr, n->n_value, n->n_len);
+
+  /* The steps, from the last one back: each needs about half the
+     digits of the next, and a couple to spare. */
+  steps = 0;
+  for (prec = half + 4; prec > SQRT_START_DIGITS; prec = prec / 2 + 2)
+    precs[steps++] = prec;
+
+  /* First guess, 1 / sqrt (x) to about two digits, from the first
+     SQRT_START_DIGITS digits of x. */
+  start = 0;
+  for (indx = 1; indx <= SQRT_START_DIGITS; indx++)
+    start = start * BASE + (indx <= 2 * half ? x->n_value[indx] : 0);
+  start = _bc_sqrt_ulong (start * 10000UL);
+  bc_init_num (&y);
+  bc_int2num (&y, (int) (10000000UL / start));
+  bc_shift10 (y, -3, &y);
+
+  bc_init_num (&t);
+  bc_init_num (&e);
+  while (steps-- > 0)
+  {
+    prec = precs[steps];
+    xp = new_sub_num (1, MIN (prec + 2, 2 * half), x->n_value);
+    bc_square (y, &t, prec);
+    bc_multiply (xp, t, &t, prec);
+    bc_sub (_one_, t, &e, prec);
+    bc_multiply (y, e, &e, prec);
+    (void) bc_div_small (e, 2, &e, NULL, prec);
+    bc_add (y, e, &y, prec);
+    bc_free_num (&xp);
+  }
 
-  /* Split u and v. */
-  if (ulen < n) {
-    u1 = bc_copy_num (_zero_);
-    u0 = new_sub_num (ulen, 0, u->n_value);
-  } else {
-    u1 = new_sub_num (ulen - n, 0, u->n_value);
-    u0 = new_sub_num (n, 0, u->n_value + ulen - n);
+  /* root = floor (x * y * 10^h), then make root^2 <= N < (root + 1)^2
+     holding diff = N - root^2. */
+  bc_multiply (x, y, &t, half + 4);
+  root = bc_new_num (t->n_len + half, 0);
+  memcpy (root->n_value, t->n_value, MIN (half, t->n_scale) + t->n_len);
+  _bc_rm_leading_zeros (root);
+  bc_init_num (&diff);
+  bc_square (root, &t, 0);
+  bc_sub (n, t, &diff, 0);
+  while (bc_is_neg (diff))
+  {
+    bc_mul_small (root, 2, &t);
+    bc_sub (t, _one_, &t, 0);
+    bc_add (diff, t, &diff, 0);
+    bc_sub (root, _one_, &root, 0);
   }
-  if (vlen < n) {
-    v1 = bc_copy_num (_zero_);
-    v0 = new_sub_num (vlen, 0, v->n_value);
-  } else {
-    v1 = new_sub_num (vlen - n, 0, v->n_value);
-    v0 = new_sub_num (n, 0, v->n_value + vlen - n);
+  for (;;)
+  {
+    bc_mul_small (root, 2, &t);
+    bc_add (t, _one_, &t, 0);
+    if (bc_compare (diff, t) < 0)
+      break;
+    bc_sub (diff, t, &diff, 0);
+    bc_add (root, _one_, &root, 0);
   }
-  _bc_rm_leading_zeros (u1);
-  _bc_rm_leading_zeros (u0);
-  _bc_rm_leading_zeros (v1);
-  _bc_rm_leading_zeros (v0);
 
-  m1zero = bc_is_zero(u1) || bc_is_zero(v1);
+  /* Assign the number and clean up. */
+  bc_free_num (num);
+  bc_shift10 (root, -rscale, num);
+  bc_free_num (&n);
+  bc_free_num (&x);
+  bc_free_num (&y);
+  bc_free_num (&t);
+  bc_free_num (&e);
+  bc_free_num (&root);
+  bc_free_num (&diff);
+  return 1;
+}
 
-  /* Calculate sub results ... */
+/* Convert a number NUM to a long.  The function returns only the integer
+   part of the number.  For numbers that are too large to represent as
+   a long, this function returns a zero.  This can be detected by checking
+   the NUM for zero after having a zero returned. */
 
-  bc_init_num(&d1);
-  bc_init_num(&d2);
-  bc_sub (u1, u0, &d1, 0);
-  d1len = d1->n_len;
-  bc_sub (v0, v1, &d2, 0);
-  d2len = d2->n_len;
+long bc_num2long (bc_num num) {
+  long val;
+  char *nptr;
+  int  index;
 
+  /* Extract the int value, ignore the fraction. */
+  val = 0;
+  nptr = num->n_value;
+  for (index = num->n_len; (index > 0) && (val <= (LONG_MAX / BASE)); index--)
+    val = val * BASE + *nptr++;
 
-  /* Do recursive multiplies and shifted adds. */
-  if (m1zero)
-    m1 = bc_copy_num (_zero_);
-  else
-    _bc_rec_mul (u1, u1->n_len, v1, v1->n_len, &m1);
+  /* Check for overflow.  If overflow, return zero. */
+  if (index > 0) val = 0;
+  if (val < 0) val = 0;
 
-  if (bc_is_zero(d1) || bc_is_zero(d2))
-    m2 = bc_copy_num (_zero_);
+  /* Return the value. */
+  if (num->n_sign == PLUS)
+    return (val);
   else
-    _bc_rec_mul (d1, d1len, d2, d2len, &m2);
+    return (-val);
+}
 
-  if (bc_is_zero(u0) || bc_is_zero(v0))
-    m3 = bc_copy_num (_zero_);
-  else
-    _bc_rec_mul (u0, u0->n_len, v0, v0->n_len, &m3);
 
-  /* Initialize product */
-  prodlen = ulen + vlen + 1;
-  *prod = bc_new_num(prodlen, 0);
+/* Convert an integer VAL to a bc number NUM. */
 
-  if (!m1zero) {
-    _bc_shift_addsub (*prod, m1, 2 * n, 0);
-    _bc_shift_addsub (*prod, m1, n, 0);
+void bc_int2num (bc_num *num, int val)
+{
+  char buffer[30];
+  char *bptr, *vptr;
+  int  ix = 1;
+  char neg = 0;
+
+  /* Sign. */
+  if (val < 0)
+  {
+    neg = 1;
+    val = -val;
   }
-  _bc_shift_addsub (*prod, m3, n, 0);
-  _bc_shift_addsub (*prod, m3, 0, 0);
-  _bc_shift_addsub (*prod, m2, n, d1->n_sign != d2->n_sign);
 
-  /* Now clean up! */
-  bc_free_num (&u1);
-  bc_free_num (&u0);
-  bc_free_num (&v1);
-  bc_free_num (&m1);
-  bc_free_num (&v0);
-  bc_free_num (&m2);
-  bc_free_num (&m3);
-  bc_free_num (&d1);
-  bc_free_num (&d2);
+  /* Get things going. */
+  bptr = buffer;
+  *bptr++ = val % BASE;
+  val = val / BASE;
+
+  /* Extract remaining digits. */
+  while (val != 0)
+  {
+    *bptr++ = val % BASE;
+    val = val / BASE;
+    ix++;             /* Count the digits. */
+  }
+
+  /* Make the number. */
+  bc_free_num (num);
+  *num = bc_new_num (ix, 0);
+  if (neg) (*num)->n_sign = MINUS;
+
+  /* Assign the digits. */
+  vptr = (*num)->n_value;
+  while (ix-- > 0)
+    *vptr++ = *--bptr;
 }
 
-/* The multiply routine.  N2 times N1 is put int PROD with the scale of
-   the result being MIN(N2 scale+N1 scale, MAX (SCALE, N2 scale, N1 scale)).
-*/
+/* Shift, multiply, divide and add with a small operand.  These take
+   one pass over the digits, for things like entering a number a digit
+   at a time, where bc_multiply and bc_divide would first have to make
+   a bc_num of the small operand. */
 
-void bc_multiply (bc_num n1, bc_num n2, bc_num *prod, int scale)
-{
-  bc_num pval;
-  int len1, len2;
-  int full_scale, prod_scale;
+#define SMALL_DIGITS (sizeof (unsigned long) * 3)  /* Room for ULONG_MAX. */
 
-  /* Initialize things. */
-  len1 = n1->n_len + n1->n_scale;
-  len2 = n2->n_len + n2->n_scale;
-  full_scale = n1->n_scale + n2->n_scale;
-  prod_scale = MIN(full_scale, MAX(scale, MAX(n1->n_scale, n2->n_scale)));
+/* Make TEMP, with its digits kept in DIGITS, the integer VAL, so VAL can
+   be passed to the general routines without a heap copy. */
 
-  /* Do the multiply */
-  _bc_rec_mul (n1, len1, n2, len2, &pval);
+static bc_num _bc_small_num (bc_struct *temp, char *digits, unsigned long val)
+{
+  unsigned long rest;
+  int len;
 
-  /* Assign to prod and clean up the number. */
-  pval->n_sign = ( n1->n_sign == n2->n_sign ? PLUS : MINUS );
-  pval->n_value = pval->n_ptr;
-  pval->n_len = len2 + len1 + 1 - full_scale;
-  pval->n_scale = prod_scale;
-  _bc_rm_leading_zeros (pval);
-  if (bc_is_zero (pval))
-    pval->n_sign = PLUS;
-  bc_free_num (prod);
-  *prod = pval;
+  for (len = 1, rest = val; rest >= BASE; rest /= BASE)
+    len++;
+  temp->n_sign = PLUS;
+  temp->n_len = len;
+  temp->n_scale = 0;
+  temp->n_refs = 1;
+  temp->n_next = NULL;
+  temp->n_ptr = NULL;
+  temp->n_value = digits;
+  temp->n_alloc = 0;
+  while (len-- > 0)
+  {
+    digits[len] = val % BASE;
+    val /= BASE;
+  }
+  return temp;
 }
 
-/* Some utility routines for the divide:  First a one digit multiply.
-   NUM (with SIZE digits) is multiplied by DIGIT and the result is
-   placed into RESULT.  It is written so that NUM and RESULT can be
-   the same pointers.  */
+/* RESULT = NUM * 10^PLACES.  The digits only move, so nothing is lost:
+   the scale of RESULT is the scale of NUM, plus -PLACES when PLACES is
+   negative.  A positive PLACES gives what bc_multiply would. */
 
-static void _one_mult (unsigned char *num, int size, int digit, unsigned char *result)
+void bc_shift10 (bc_num num, int places, bc_num *result)
 {
-  int carry, value;
-  unsigned char *nptr, *rptr;
+  bc_num temp;
+  int digits;
 
-  if (digit == 0)
-    memset (result, 0, size);
+  digits = num->n_len + num->n_scale;
+  if (places >= 0)
+  {
+    /* Zeros come in at the bottom. */
+    temp = bc_new_num (num->n_len + places, num->n_scale);
+    memcpy (temp->n_value, num->n_value, digits);
+    memset (temp->n_value + digits, 0, places);
+  }
   else
   {
-    if (digit == 1)
-      memcpy (result, num, size);
-    else
-    {
-      /* Initialize */
-      nptr = (unsigned char *) (num + size - 1);
-      rptr = (unsigned char *) (result + size - 1);
-      carry = 0;
+    /* Leading zeros for the integer digits that are not there. */
+    temp = bc_new_num (MAX (num->n_len + places, 1), num->n_scale - places);
+    memset (temp->n_value, 0, temp->n_len + temp->n_scale - digits);
+    memcpy (temp->n_value + temp->n_len + temp->n_scale - digits,
+            num->n_value, digits);
+  }
+  _bc_rm_leading_zeros (temp);
+  temp->n_sign = (bc_is_zero (temp) ? PLUS : num->n_sign);
+  bc_free_num (result);
+  *result = temp;
+}
 
-      while (size-- > 0)
-      {
-        value = *nptr-- * digit + carry;
-        *rptr-- = value % BASE;
-        carry = value / BASE;
-      }
+/* RESULT = NUM * VAL, with the scale of NUM, which is also what
+   bc_multiply gives. */
 
-      if (carry != 0) *rptr = carry;
-    }
+void bc_mul_small (bc_num num, unsigned long val, bc_num *result)
+{
+  bc_struct small;
+  char small_digits[SMALL_DIGITS];
+  bc_num prod;
+  char *nptr, *pptr;
+  unsigned long value, carry, rest;
+  int vlen, count;
+
+  /* A digit times VAL plus the carry has to fit. */
+  if (val > ULONG_MAX / BASE)
+  {
+    bc_multiply (num, _bc_small_num (&small, small_digits, val), result, 0);
+    return;
+  }
+
+  for (vlen = 1, rest = val; rest >= BASE; rest /= BASE)
+    vlen++;
+  count = num->n_len + num->n_scale;
+  prod = bc_new_num (num->n_len + vlen, num->n_scale);
+  nptr = num->n_value + count - 1;
+  pptr = prod->n_value + count + vlen - 1;
+  carry = 0;
+  while (count-- > 0)
+  {
+    value = *nptr-- * val + carry;
+    *pptr-- = value % BASE;
+    carry = value / BASE;
+  }
+  while (vlen-- > 0)
+  {
+    *pptr-- = carry % BASE;
+    carry /= BASE;
   }
-}
 
+  _bc_rm_leading_zeros (prod);
+  prod->n_sign = (bc_is_zero (prod) ? PLUS : num->n_sign);
+  bc_free_num (result);
+  *result = prod;
+}
 
-/* The full division routine. This computes N1 / N2.  It returns
-   0 if the division is ok and the result is in QUOT.  The number of
-   digits after the decimal point is SCALE. It returns -1 if division
-   by zero is tried.  The algorithm is found in Knuth Vol 2. p237. */
+/* QUOT = NUM / VAL, truncated to SCALE digits after the decimal point
+   as bc_divide does.  If REM is not NULL it gets what is left over, in
+   units of the last quotient digit: the digits of NUM down to that
+   place, as an integer, less the digits of QUOT times VAL.  Returns -1,
+   doing nothing, if VAL is zero. */
 
-int bc_divide (bc_num n1, bc_num n2, bc_num *quot, int scale)
+int bc_div_small (bc_num num, unsigned long val, bc_num *quot,
+                  unsigned long *rem, int scale)
 {
-  bc_num qval;
-  unsigned char *num1, *num2;
-  unsigned char *ptr1, *ptr2, *n2ptr, *qptr;
-  int  scale1, val;
-  unsigned int  len1, len2, scale2, qdigits, extra, count;
-  unsigned int  qdig, qguess, borrow, carry;
-  unsigned char *mval;
-  char zero;
-  unsigned int  norm;
+  bc_struct small;
+  char small_digits[SMALL_DIGITS];
+  bc_num qval, temp;
+  char *nptr, *qptr;
+  unsigned long value;
+  int digits, count;
 
-  /* Test for divide by zero. */
-  if (bc_is_zero (n2)) return -1;
+  if (val == 0) return -1;
 
-  /* Test for divide by 1.  If it is we must truncate. */
-  if (n2->n_scale == 0)
+  if (val > ULONG_MAX / BASE)
   {
-    if (n2->n_len == 1 && *n2->n_value == 1)
+    /* Let bc_divide do it, and read the remainder off NUM - QUOT * VAL. */
+    bc_init_num (&qval);
+    bc_init_num (&temp);
+    bc_divide (num, _bc_small_num (&small, small_digits, val), &qval, scale);
+    bc_multiply (qval, &small, &temp, scale);
+    bc_sub (num, temp, &temp, scale);
+    value = 0;
+    nptr = temp->n_value;
+    for (count = temp->n_len + scale; count > 0; count--)
+      value = value * BASE + *nptr++;
+    bc_free_num (&temp);
+  }
+  else
+  {
+    digits = num->n_len + MIN (num->n_scale, scale);
+    qval = bc_new_num (num->n_len, scale);
+    nptr = num->n_value;
+    qptr = qval->n_value;
+    value = 0;
+    for (count = 0; count < num->n_len + scale; count++)
     {
-      qval = bc_new_num (n1->n_len, scale);
-      qval->n_sign = (n1->n_sign == n2->n_sign ? PLUS : MINUS);
-      memset (&qval->n_value[n1->n_len], 0, scale);
-      memcpy (qval->n_value, n1->n_value,
-              n1->n_len + MIN(n1->n_scale, scale));
-      bc_free_num (quot);
-      *quot = qval;
+      value = value * BASE + (count < digits ? *nptr++ : 0);
+      *qptr++ = value / val;
+      value %= val;
     }
+    _bc_rm_leading_zeros (qval);
+    qval->n_sign = (bc_is_zero (qval) ? PLUS : num->n_sign);
   }
 
-  /* Set up the divide.  Move the decimal point on n1 by n2's scale.
-     Remember, zeros on the end of num2 are wasted effort for dividing. */
-  scale2 = n2->n_scale;
-  n2ptr = (unsigned char *) n2->n_value + n2->n_len + scale2 - 1;
-  while ((scale2 > 0) && (*n2ptr-- == 0)) scale2--;
+  bc_free_num (quot);
+  *quot = qval;
+  if (rem != NULL) *rem = value;
+  return 0;
+}
 
-  len1 = n1->n_len + scale2;
-  scale1 = n1->n_scale - scale2;
-  if (scale1 < scale)
-    extra = scale - scale1;
-  else
-    extra = 0;
-  num1 = (unsigned char *) malloc (n1->n_len + n1->n_scale + extra + 2);
-  if (num1 == NULL) bc_out_of_memory();
-  memset (num1, 0, n1->n_len + n1->n_scale + extra + 2);
-  memcpy (num1 + 1, n1->n_value, n1->n_len + n1->n_scale);
+/* RESULT = NUM + VAL, with at least SCALE_MIN digits after the decimal
+   point, as bc_add gives. */
 
-  len2 = n2->n_len + scale2;
-  num2 = (unsigned char *) malloc (len2 + 1);
-  if (num2 == NULL) bc_out_of_memory();
-  memcpy (num2, n2->n_value, len2);
-  *(num2 + len2) = 0;
-  n2ptr = num2;
-  while (*n2ptr == 0)
-  {
-    n2ptr++;
-    len2--;
-  }
+void bc_add_small (bc_num num, unsigned long val, bc_num *result,
+                   int scale_min)
+{
+  bc_struct small;
+  char small_digits[SMALL_DIGITS];
 
-  /* Calculate the number of quotient digits. */
-  if (len2 > len1 + scale)
+  bc_add (num, _bc_small_num (&small, small_digits, val), result,
+          scale_min);
+}
+
+/* Batches, columns of numbers of one shape (see bc_batch).  The loops
+   go one digit position at a time across a block of up to BATCH_BLOCK
+   numbers, keeping the carries of the block in arrays, so that the
+   compiler can vectorize them across numbers.  Each row of a block is
+   contiguous. */
+
+#define BATCH_BLOCK 256
+#define BATCH_ROW(batch, pos) \
+  ((unsigned char *) (batch)->b_digits + (size_t) (pos) * (batch)->b_count)
+
+/* Make BATCH a column of COUNT zeros with LEN (at least 1) integer
+   digits and SCALE digits after the decimal point, in one block. */
+
+void bc_batch_init (bc_batch *batch, int count, int len, int scale)
+{
+  size_t digits;
+
+  len = MAX (len, 1);
+  digits = (size_t) (len + scale) * count;
+  batch->b_count = count;
+  batch->b_len = len;
+  batch->b_scale = scale;
+  batch->b_digits = (char *) calloc (digits + count + 1, 1);
+  if (batch->b_digits == NULL) bc_out_of_memory ();
+  batch->b_signs = batch->b_digits + digits;
+}
+
+void bc_batch_free (bc_batch *batch)
+{
+  free (batch->b_digits);
+  batch->b_digits = NULL;
+  batch->b_signs = NULL;
+}
+
+/* Store NUM as number INDX of BATCH, truncated to its scale.  Returns
+   -1, doing nothing, if the integer part of NUM does not fit. */
+
+int bc_batch_set (bc_batch *batch, int indx, bc_num num)
+{
+  const char *nptr;
+  unsigned char *dptr;
+  int len, pos, src, digit;
+  char nonzero;
+
+  nptr = num->n_value;
+  len = num->n_len;
+  while (len > 0 && *nptr == 0)
   {
-    qdigits = scale + 1;
-    zero = TRUE;
+    nptr++;
+    len--;
   }
-  else
+  if (len > batch->b_len) return -1;
+
+  nonzero = 0;
+  dptr = (unsigned char *) batch->b_digits + indx;
+  for (pos = 0; pos < batch->b_len + batch->b_scale; pos++)
   {
-    zero = FALSE;
-    if (len2 > len1)
-      qdigits = scale + 1;    /* One for the zero integer part. */
-    else
-      qdigits = len1 - len2 + scale + 1;
+    src = pos - (batch->b_len - len);
+    digit = (src >= 0 && src < len + num->n_scale ? nptr[src] : 0);
+    dptr[(size_t) pos * batch->b_count] = digit;
+    nonzero |= digit;
   }
+  batch->b_signs[indx] = (nonzero ? num->n_sign : PLUS);
+  return 0;
+}
 
-  /* Allocate and zero the storage for the quotient. */
-  qval = bc_new_num (qdigits - scale, scale);
-  memset (qval->n_value, 0, qdigits);
+/* NUM = number INDX of BATCH. */
 
-  /* Allocate storage for the temporary storage mval. */
-  mval = (unsigned char *) malloc (len2 + 1);
-  if (mval == NULL) bc_out_of_memory ();
+void bc_batch_get (const bc_batch *batch, int indx, bc_num *num)
+{
+  const unsigned char *dptr;
+  bc_num temp;
+  int skip, pos;
+
+  dptr = (const unsigned char *) batch->b_digits + indx;
+  for (skip = 0;
+       skip < batch->b_len - 1 && dptr[(size_t) skip * batch->b_count] == 0;
+       skip++)
+    ;
+  temp = bc_new_num (batch->b_len - skip, batch->b_scale);
+  for (pos = skip; pos < batch->b_len + batch->b_scale; pos++)
+    temp->n_value[pos - skip] = dptr[(size_t) pos * batch->b_count];
+  temp->n_sign = (bc_is_zero (temp) ? PLUS : batch->b_signs[indx]);
+  bc_free_num (num);
+  *num = temp;
+}
 
-  /* Now for the full divide algorithm. */
-  if (!zero)
+/* RESULT = N1 + N2, or N1 - N2 if NEGATE, number by number.  A lane
+   whose signs differ adds the nines complement of N2 plus one, which
+   is N1 - N2 + 10^D; with no carry out N1 was the smaller and that is
+   complemented back in a second pass. */
+
+static int _bc_batch_addsub (const bc_batch *n1, const bc_batch *n2,
+                             bc_batch *result, int negate)
+{
+  unsigned char carry[BATCH_BLOCK], flip[BATCH_BLOCK], nonzero[BATCH_BLOCK];
+  const unsigned char *aptr, *bptr;
+  unsigned char *rptr, value, any;
+  int digits, extra, first, lanes, lane, pos;
+
+  if (n1->b_count != n2->b_count || n1->b_count != result->b_count
+      || n1->b_len != n2->b_len || n1->b_scale != n2->b_scale
+      || result->b_scale != n1->b_scale || result->b_len <= n1->b_len)
+    return -1;
+
+  digits = n1->b_len + n1->b_scale;
+  extra = result->b_len - n1->b_len;     /* Room for the carry. */
+  for (first = 0; first < n1->b_count; first += BATCH_BLOCK)
   {
-    /* Normalize */
-    norm =  10 / ((int) * n2ptr + 1);
-    if (norm != 1)
+    lanes = MIN (BATCH_BLOCK, n1->b_count - first);
+    for (lane = 0; lane < lanes; lane++)
     {
-      _one_mult (num1, len1 + scale1 + extra + 1, norm, num1);
-      _one_mult (n2ptr, len2, norm, n2ptr);
+      flip[lane] = n1->b_signs[first + lane]
+                   ^ n2->b_signs[first + lane] ^ (negate != 0);
+      carry[lane] = flip[lane];
+      nonzero[lane] = 0;
     }
 
-    /* Initialize divide loop. */
-    qdig = 0;
-    if (len2 > len1)
-      qptr = (unsigned char *) qval->n_value + len2 - len1;
-    else
-      qptr = (unsigned char *) qval->n_value;
-
-    /* Loop */
-    while (qdig <= len1 + scale - len2)
+    /* The sum, or the complemented difference. */
+    for (pos = digits - 1; pos >= 0; pos--)
     {
-      /* Calculate the quotient digit guess. */
-      if (*n2ptr == num1[qdig])
-        qguess = 9;
-      else
-        qguess = (num1[qdig] * 10 + num1[qdig + 1]) / *n2ptr;
-
-      /* Test qguess. */
-      if (n2ptr[1]*qguess >
-          (num1[qdig] * 10 + num1[qdig + 1] - *n2ptr * qguess) * 10
-          + num1[qdig + 2])
-      {
-        qguess--;
-        /* And again. */
-        if (n2ptr[1]*qguess >
-            (num1[qdig] * 10 + num1[qdig + 1] - *n2ptr * qguess) * 10
-            + num1[qdig + 2])
-          qguess--;
-      }
-
-      /* Multiply and subtract. */
-      borrow = 0;
-      if (qguess != 0)
+      aptr = BATCH_ROW (n1, pos) + first;
+      bptr = BATCH_ROW (n2, pos) + first;
+      rptr = BATCH_ROW (result, pos + extra) + first;
+      for (lane = 0; lane < lanes; lane++)
       {
-        *mval = 0;
-        _one_mult (n2ptr, len2, qguess, mval + 1);
-        ptr1 = (unsigned char *) num1 + qdig + len2;
-        ptr2 = (unsigned char *) mval + len2;
-        for (count = 0; count < len2 + 1; count++)
-        {
-          val = (int) * ptr1 - (int) * ptr2-- - borrow;
-          if (val < 0)
-          {
-            val += 10;
-            borrow = 1;
-          }
-          else
-            borrow = 0;
-          *ptr1-- = val;
-        }
+        value = aptr[lane] + (flip[lane] ? 9 - bptr[lane] : bptr[lane])
+                + carry[lane];
+        carry[lane] = (value >= BASE);
+        rptr[lane] = value - (carry[lane] ? BASE : 0);
+        nonzero[lane] |= rptr[lane];
       }
+    }
+    for (pos = 0; pos < extra; pos++)
+    {
+      rptr = BATCH_ROW (result, pos) + first;
+      for (lane = 0; lane < lanes; lane++)
+        rptr[lane] = (pos == extra - 1 && !flip[lane] ? carry[lane] : 0);
+    }
 
-      /* Test for negative result. */
-      if (borrow == 1)
+    /* Lanes that went below zero: flip is now their sign change. */
+    any = 0;
+    for (lane = 0; lane < lanes; lane++)
+    {
+      nonzero[lane] |= (flip[lane] ^ 1) & carry[lane];
+      flip[lane] &= carry[lane] ^ 1;
+      carry[lane] = flip[lane];
+      any |= flip[lane];
+    }
+    if (any)
+      for (pos = digits - 1; pos >= 0; pos--)
       {
-        qguess--;
-        ptr1 = (unsigned char *) num1 + qdig + len2;
-        ptr2 = (unsigned char *) n2ptr + len2 - 1;
-        carry = 0;
-        for (count = 0; count < len2; count++)
+        rptr = BATCH_ROW (result, pos + extra) + first;
+        for (lane = 0; lane < lanes; lane++)
         {
-          val = (int) * ptr1 + (int) * ptr2-- + carry;
-          if (val > 9)
-          {
-            val -= 10;
-            carry = 1;
-          }
-          else
-            carry = 0;
-          *ptr1-- = val;
+          value = (flip[lane] ? 9 - rptr[lane] : rptr[lane]) + carry[lane];
+          carry[lane] = (value >= BASE);
+          rptr[lane] = value - (carry[lane] ? BASE : 0);
         }
-        if (carry == 1) *ptr1 = (*ptr1 + 1) % 10;
       }
 
-      /* We now know the quotient digit. */
-      *qptr++ =  qguess;
-      qdig++;
-    }
+    for (lane = 0; lane < lanes; lane++)
+      result->b_signs[first + lane] =
+        (nonzero[lane] ? n1->b_signs[first + lane] ^ flip[lane] : PLUS);
   }
+  return 0;
+}
 
-  /* Clean up and return the number. */
-  qval->n_sign = ( n1->n_sign == n2->n_sign ? PLUS : MINUS );
-  if (bc_is_zero (qval)) qval->n_sign = PLUS;
-  _bc_rm_leading_zeros (qval);
-  bc_free_num (quot);
-  *quot = qval;
-
-  /* Clean up temporary storage. */
-  free (mval);
-  free (num1);
-  free (num2);
+/* RESULT = N1 + N2 for each number of the batches.  N1 and N2 have the
+   same shape, RESULT the same scale and at least one more integer
+   digit.  Returns -1, doing nothing, if the shapes do not fit. */
 
-  return 0;     /* Everything is OK. */
+int bc_add_batch (const bc_batch *n1, const bc_batch *n2, bc_batch *result)
+{
+  return _bc_batch_addsub (n1, n2, result, FALSE);
 }
 
+/* RESULT = N1 - N2, as bc_add_batch. */
 
-/* Division *and* modulo for numbers.  This computes both NUM1 / NUM2 and
-   NUM1 % NUM2  and puts the results in QUOT and REM, except that if QUOT
-   is NULL then that store will be omitted.
-*/
+int bc_sub_batch (const bc_batch *n1, const bc_batch *n2, bc_batch *result)
+{
+  return _bc_batch_addsub (n1, n2, result, TRUE);
+}
 
-int bc_divmod (bc_num num1, bc_num num2, bc_num *quot, bc_num *rem, int scale)
+/* RESULT = N1 * N2 for each number of the batches, truncated to the
+   scale of RESULT (or padded with zeros) as bc_multiply truncates.
+   RESULT needs as many integer digits as N1 and N2 together.  Returns
+   -1, doing nothing, if it does not have them.  Columns of the product
+   are summed across the block, one digit pair at a time. */
+
+int bc_mul_batch (const bc_batch *n1, const bc_batch *n2, bc_batch *result)
 {
-  bc_num quotient = NULL;
-  bc_num temp;
-  int rscale;
+  uint32_t acc[BATCH_BLOCK];
+  unsigned char nonzero[BATCH_BLOCK];
+  const unsigned char *aptr, *bptr;
+  unsigned char *rptr;
+  int d1, d2, full_scale, first, lanes, lane, col, pos, indx, low, high;
+
+  if (n1->b_count != n2->b_count || n1->b_count != result->b_count
+      || result->b_len < n1->b_len + n2->b_len)
+    return -1;
+
+  d1 = n1->b_len + n1->b_scale;
+  d2 = n2->b_len + n2->b_scale;
+  full_scale = n1->b_scale + n2->b_scale;
+  for (first = 0; first < n1->b_count; first += BATCH_BLOCK)
+  {
+    lanes = MIN (BATCH_BLOCK, n1->b_count - first);
+    for (lane = 0; lane < lanes; lane++)
+    {
+      acc[lane] = 0;
+      nonzero[lane] = 0;
+    }
 
-  /* Check for correct numbers. */
-  if (bc_is_zero (num2)) return -1;
+    /* Column COL of the product is worth 10^(COL - full_scale).  Rows
+       of the result outside the product are zero. */
+    for (pos = 0; pos < result->b_len + result->b_scale; pos++)
+    {
+      col = result->b_len - 1 - pos + full_scale;
+      if (col < 0 || col >= d1 + d2)
+        memset (BATCH_ROW (result, pos) + first, 0, lanes);
+    }
 
-  /* Calculate final scale. */
-  rscale = MAX (num1->n_scale, num2->n_scale + scale);
-  bc_init_num(&temp);
+    /* Every column is summed for its carry; the result keeps those it
+       has rows for. */
+    for (col = 0; col < d1 + d2; col++)
+    {
+      low = MAX (0, col - d2 + 1);
+      high = MIN (col, d1 - 1);
+      for (indx = low; indx <= high; indx++)
+      {
+        aptr = BATCH_ROW (n1, d1 - 1 - indx) + first;
+        bptr = BATCH_ROW (n2, d2 - 1 - (col - indx)) + first;
+        for (lane = 0; lane < lanes; lane++)
+          acc[lane] += aptr[lane] * bptr[lane];
+      }
+      pos = result->b_len - 1 - (col - full_scale);
+      if (pos >= 0 && pos < result->b_len + result->b_scale)
+      {
+        rptr = BATCH_ROW (result, pos) + first;
+        for (lane = 0; lane < lanes; lane++)
+        {
+          rptr[lane] = acc[lane] % BASE;
+          nonzero[lane] |= rptr[lane];
+        }
+      }
+      for (lane = 0; lane < lanes; lane++)
+        acc[lane] /= BASE;
+    }
 
-  /* Calculate it. */
-  bc_divide (num1, num2, &temp, scale);
-  if (quot)
-    quotient = bc_copy_num (temp);
-  bc_multiply (temp, num2, &temp, rscale);
-  bc_sub (num1, temp, rem, rscale);
-  bc_free_num (&temp);
+    for (lane = 0; lane < lanes; lane++)
+      result->b_signs[first + lane] =
+        (nonzero[lane] ? n1->b_signs[first + lane]
+                         ^ n2->b_signs[first + lane] : PLUS);
+  }
+  return 0;
+}
 
-  if (quot)
+/* ASCII kernels for bc_str2num_n and bc_num2str_into, taking 32 (AVX2)
+   or 16 (SSE2) chars per step on SIMD builds.  A char is in LOW..HIGH
+   if it less LOW, unsigned, is at most HIGH - LOW. */
+
+/* Return how many of the first COUNT chars at PTR are from LOW to
+   HIGH. */
+
+static int _bc_ascii_run (const char *ptr, int count, char low, char high)
+{
+  int indx;
+#if defined(BC_SIMD)
+  uint32_t outside;
+#endif
+
+  indx = 0;
+#if defined(BC_SIMD)
+#if defined(__AVX2__)
   {
-    bc_free_num (quot);
-    *quot = quotient;
+    const __m256i base = _mm256_set1_epi8 (low);
+    const __m256i span = _mm256_set1_epi8 (high - low);
+    __m256i chars;
+
+    for (; indx + 32 <= count; indx += 32)
+    {
+      chars = _mm256_sub_epi8 (
+                _mm256_loadu_si256 ((const __m256i *) (ptr + indx)), base);
+      outside = ~(uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (
+                  _mm256_max_epu8 (chars, span), span));
+      if (outside != 0)
+        return indx + __builtin_ctz (outside);
+    }
   }
+#endif
+  {
+    const __m128i base = _mm_set1_epi8 (low);
+    const __m128i span = _mm_set1_epi8 (high - low);
+    __m128i chars;
 
-  return 0;     /* Everything is OK. */
+    for (; indx + 16 <= count; indx += 16)
+    {
+      chars = _mm_sub_epi8 (_mm_loadu_si128 ((const __m128i *) (ptr + indx)),
+                            base);
+      outside = 0xFFFF & ~(uint32_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (
+                  _mm_max_epu8 (chars, span), span));
+      if (outside != 0)
+        return indx + __builtin_ctz (outside);
+    }
+  }
+#endif
+  while (indx < count && ptr[indx] >= low && ptr[indx] <= high)
+    indx++;
+  return indx;
 }
 
+/* DEST = the COUNT chars at SRC plus OFFSET: '0' to make ASCII from
+   digits, -'0' to make digits from ASCII. */
 
-/* Modulo for numbers.  This computes NUM1 % NUM2  and puts the
-   result in RESULT.   */
-
-int bc_modulo (bc_num num1, bc_num num2, bc_num *result, int scale)
+static void _bc_ascii_shift (char *dest, const char *src, int count,
+                             char offset)
 {
-  return bc_divmod (num1, num2, NULL, result, scale);
+  int indx;
+
+  indx = 0;
+#if defined(BC_SIMD)
+#if defined(__AVX2__)
+  for (; indx + 32 <= count; indx += 32)
+    _mm256_storeu_si256 ((__m256i *) (dest + indx), _mm256_add_epi8 (
+      _mm256_loadu_si256 ((const __m256i *) (src + indx)),
+      _mm256_set1_epi8 (offset)));
+#endif
+  for (; indx + 16 <= count; indx += 16)
+    _mm_storeu_si128 ((__m128i *) (dest + indx), _mm_add_epi8 (
+      _mm_loadu_si128 ((const __m128i *) (src + indx)),
+      _mm_set1_epi8 (offset)));
+#endif
+  for (; indx < count; indx++)
+    dest[indx] = src[indx] + offset;
 }
 
-/* Raise BASE to the EXPO power, reduced modulo MOD.  The result is
-   placed in RESULT.  If a EXPO is not an integer,
-   only the integer part is used.  */
+/* Write NUM as bc_num2str does into BUF, which has room for LEN chars
+   with the terminating NUL.  What does not fit is cut off the end.
+   NEEDED, if not NULL, gets the room the whole string takes.  Returns
+   0 if it all fit, -1 if it was cut.  Nothing is allocated. */
 
-int bc_raisemod (bc_num base, bc_num expo, bc_num mod, bc_num *result, int scale)
+int bc_num2str_into (bc_num num, char *buf, int len, int *needed)
 {
-  bc_num power, exponent, parity, temp;
-  int rscale;
+  char *sptr, *end;
+  int count, signch, total;
 
-  /* Check for correct numbers. */
-  if (bc_is_zero(mod)) return -1;
-  if (bc_is_neg(expo)) return -1;
+  signch = ( num->n_sign == PLUS ? 0 : 1 );  /* Number of sign chars. */
+  total = signch + num->n_len + 1;
+  if (num->n_scale > 0)
+    total += num->n_scale + 1;
+  if (needed != NULL) *needed = total;
+  if (len <= 0) return -1;
 
-  /* Set initial values.  */
-  power = bc_copy_num (base);
-  exponent = bc_copy_num (expo);
-  temp = bc_copy_num (_one_);
-  bc_init_num(&parity);
+  /* The negative sign if needed. */
+  sptr = buf;
+  end = buf + len - 1;
+  if (signch && sptr < end) *sptr++ = '-';
 
-  /* Check the base for scale digits. */
-  if (base->n_scale != 0)
-    bc_rt_warn (BC_WARNING_NON_ZERO_SCALE_IN_BASE);
+  /* Load the whole number. */
+  count = MIN (num->n_len, end - sptr);
+  _bc_ascii_shift (sptr, num->n_value, count, '0');
+  sptr += count;
 
-  /* Check the exponent for scale digits. */
-  if (exponent->n_scale != 0)
+  /* Now the fraction. */
+  if (num->n_scale > 0 && sptr < end)
   {
-    bc_rt_warn (BC_WARNING_NON_ZERO_SCALE_IN_EXPONENT);
-    bc_divide (exponent, _one_, &exponent, 0); /*truncate */
+    *sptr++ = '.';
+    count = MIN (num->n_scale, end - sptr);
+    _bc_ascii_shift (sptr, num->n_value + num->n_len, count, '0');
+    sptr += count;
   }
 
-  /* Check the modulus for scale digits. */
-  if (mod->n_scale != 0)
-    bc_rt_warn (BC_WARNING_NON_ZERO_SCALE_IN_MODULUS);
+  /* Terminate the string. */
+  *sptr = '\0';
+  return (total <= len ? 0 : -1);
+}
 
-  /* Do the calculation. */
-  rscale = MAX(scale, base->n_scale);
-  while ( !bc_is_zero(exponent) )
-  {
-    (void) bc_divmod (exponent, _two_, &exponent, &parity, 0);
-    if ( !bc_is_zero(parity) )
-    {
-      bc_multiply (temp, power, &temp, rscale);
-      (void) bc_modulo (temp, mod, &temp, scale);
-    }
+/* Convert a numbers to a string.  Base 10 only.*/
+char *num2str (bc_num num)
+{
+  char *str;
+  int needed;
 
-    bc_multiply (power, power, &power, rscale);
-    (void) bc_modulo (power, mod, &power, scale);
-  }
+  /* Allocate the string memory. */
+  (void) bc_num2str_into (num, NULL, 0, &needed);
+  str = (char *) malloc (needed);
+  if (str == NULL) bc_out_of_memory();
 
-  /* Assign the value. */
-  bc_free_num (&power);
-  bc_free_num (&exponent);
-  bc_free_num (result);
-  bc_free_num (&parity);
-  *result = temp;
-  return 0;     /* Everything is OK. */
+  (void) bc_num2str_into (num, str, needed, NULL);
+  return (str);
 }
 
-/* Raise NUM1 to the NUM2 power.  The result is placed in RESULT.
-   Maximum exponent is LONG_MAX.  If a NUM2 is not an integer,
-   only the integer part is used.  */
+/* Convert the LEN chars at STR to a bc number, as bc_str2num does.  STR
+   need not be terminated.  Base 10 only. */
 
-void bc_raise (bc_num num1, bc_num num2, bc_num *result, int scale)
+void bc_str2num_n (bc_num *num, const char *str, int len, int scale)
 {
-  bc_num temp, power;
-  long exponent;
-  int rscale;
-  int pwrscale;
-  int calcscale;
-  char neg;
+  int digits, strscale;
+  const char *ptr, *end, *int_digits, *frac_digits;
+  sign n_sign;
 
-  /* Check the exponent for scale digits and convert to a long. */
-  if (num2->n_scale != 0)
-    bc_rt_warn (BC_WARNING_NON_ZERO_SCALE_IN_EXPONENT);
-  exponent = bc_num2long (num2);
-  if (exponent == 0 && (num2->n_len > 1 || num2->n_value[0] != 0))
-    bc_rt_error (BC_ERROR_EXPONENT_TOO_LARGE_IN_RAISE);
+  /* Prepare num. */
+  bc_free_num (num);
 
-  /* Special case if exponent is a zero. */
-  if (exponent == 0)
+  /* Check for valid number and count digits. */
+  ptr = str;
+  end = str + len;
+  n_sign = PLUS;
+  if (ptr < end && ((*ptr == '+') || (*ptr == '-')))  /* Sign */
+    n_sign = (*ptr++ == '-' ? MINUS : PLUS);
+  ptr += _bc_ascii_run (ptr, end - ptr, '0', '0');   /* Skip leading zeros. */
+  int_digits = ptr;
+  digits = _bc_ascii_run (ptr, end - ptr, '0', '9'); /* digits */
+  ptr += digits;
+  if (ptr < end && *ptr == '.') ptr++;               /* decimal point */
+  frac_digits = ptr;
+  strscale = _bc_ascii_run (ptr, end - ptr, '0', '9'); /* digits */
+  ptr += strscale;
+  if ((ptr < end) || (digits + strscale == 0))
   {
-    bc_free_num (result);
-    *result = bc_copy_num (_one_);
+    *num = bc_copy_num (_zero_);
     return;
   }
 
-  /* Other initializations. */
-  if (exponent < 0)
+  /* Adjust numbers and allocate storage and initialize fields. */
+  strscale = MIN(strscale, scale);
+  if (digits == 0)
   {
-    neg = TRUE;
-    exponent = -exponent;
-    rscale = scale;
+    *num = bc_new_num (1, strscale);
+    (*num)->n_value[0] = 0;
   }
   else
   {
-    neg = FALSE;
-    rscale = MIN (num1->n_scale * exponent, MAX(scale, num1->n_scale));
+    *num = bc_new_num (digits, strscale);
+    _bc_ascii_shift ((*num)->n_value, int_digits, digits, -'0');
   }
+  (*num)->n_sign = n_sign;
 
-  /* Set initial value of temp.  */
-  power = bc_copy_num (num1);
-  pwrscale = num1->n_scale;
-  while ((exponent & 1) == 0)
-  {
-    pwrscale = 2 * pwrscale;
-    bc_multiply (power, power, &power, pwrscale);
-    exponent = exponent >> 1;
-  }
-  temp = bc_copy_num (power);
-  calcscale = pwrscale;
-  exponent = exponent >> 1;
+  /* Build the fractional part. */
+  _bc_ascii_shift ((*num)->n_value + (*num)->n_len, frac_digits, strscale,
+                   -'0');
+}
 
-  /* Do the calculation. */
-  while (exponent > 0)
+/* Convert strings to bc numbers.  Base 10 only.*/
+
+void bc_str2num (bc_num *num, const char *str, int scale)
+{
+  bc_str2num_n (num, str, strlen (str), scale);
+}
+
+/* Conversion to and from other bases.  A number of n base B digits is
+   split at B^(k 2^i), the largest such power below it, and the two
+   halves are converted the same way, down to k digits that fit an
+   unsigned long.  The divides (multiplies, when reading) at each level
+   of that tree add up to about the cost of one at full length, where
+   taking off one digit at a time costs n divides of length n.  The
+   powers B^(k 2^i) are kept in the current context for the last base
+   used. */
+
+#define RADIX_LEVELS BC_RADIX_LEVELS
+#define _bc_radix (bc_current->c_radix)
+
+static void _bc_radix_free (void)
+{
+  while (_bc_radix.levels > 0)
+    bc_free_num (&_bc_radix.pow[--_bc_radix.levels]);
+  _bc_radix.base = 0;
+}
+
+/* Make the radix tree the one for BASE, at least 2. */
+
+static void _bc_radix_base (int base)
+{
+  unsigned long limit;
+
+  if (_bc_radix.base == base) return;
+  _bc_radix_free ();
+  _bc_radix.base = base;
+  _bc_radix.leaf = 0;
+  for (limit = ULONG_MAX; limit >= (unsigned long) base; limit /= base)
+    _bc_radix.leaf++;
+}
+
+/* A new number holding VAL. */
+
+static bc_num _bc_ulong_num (unsigned long val)
+{
+  bc_struct small;
+  char small_digits[SMALL_DIGITS];
+  bc_num temp;
+
+  _bc_small_num (&small, small_digits, val);
+  temp = bc_new_num (small.n_len, 0);
+  memcpy (temp->n_value, small.n_value, small.n_len);
+  return temp;
+}
+
+/* base^(leaf 2^LEVEL), made on first use. */
+
+static bc_num _bc_radix_pow (int level)
+{
+  unsigned long power;
+  int count;
+
+  while (_bc_radix.levels <= level)
   {
-    pwrscale = 2 * pwrscale;
-    bc_multiply (power, power, &power, pwrscale);
-    if ((exponent & 1) == 1) {
-      calcscale = pwrscale + calcscale;
-      bc_multiply (temp, power, &temp, calcscale);
+    if (_bc_radix.levels == 0)
+    {
+      for (power = 1, count = 0; count < _bc_radix.leaf; count++)
+        power *= _bc_radix.base;
+      _bc_radix.pow[0] = _bc_ulong_num (power);
     }
-    exponent = exponent >> 1;
+    else
+      bc_square (_bc_radix.pow[_bc_radix.levels - 1],
+                 &_bc_radix.pow[_bc_radix.levels], 0);
+    _bc_radix.levels++;
   }
+  return _bc_radix.pow[level];
+}
 
-  /* Assign the value. */
-  if (neg)
+/* Where bc_out_num sends the digits. */
+
+typedef struct bc_out_state
+{
+  void (*out_char) (int);
+  int  base;
+  int  width;		/* Decimal digits in a digit, for bases over 16. */
+  char space;		/* Put a space before the next digit. */
+} bc_out_state;
+
+static void _bc_out_digit (bc_out_state *out, unsigned long digit)
+{
+  static const char ref_str[] = "0123456789ABCDEF";
+  char buffer[SMALL_DIGITS];
+  int index;
+
+  if (out->base <= 16)
   {
-    bc_divide (_one_, temp, result, rscale);
-    bc_free_num (&temp);
+    (*out->out_char) (ref_str[digit]);
+    return;
   }
-  else
+
+  /* Bigger bases show each digit in decimal, after a space. */
+  if (out->space) (*out->out_char) (' ');
+  out->space = TRUE;
+  for (index = 0; index < out->width; index++)
   {
-    bc_free_num (result);
-    *result = temp;
-    if ((*result)->n_scale > rscale)
-      (*result)->n_scale = rscale;
+    buffer[index] = BCD_CHAR (digit % BASE);
+    digit /= BASE;
   }
-  bc_free_num (&power);
+  while (index-- > 0)
+    (*out->out_char) (buffer[index]);
 }
 
-/* Take the square root NUM and return it in NUM with SCALE digits
-   after the decimal place. */
+/* Send the integer NUM, at least zero and below base^leaf, as exactly
+   WIDTH digits, or as few as it takes (none for zero) if WIDTH is
+   negative. */
 
-int bc_sqrt (bc_num *num, int scale)
+static void _bc_out_leaf (bc_out_state *out, bc_num num, int width)
 {
-  int rscale, cmp_res, done;
-  int cscale;
-  bc_num guess, guess1, point5, diff;
+  unsigned long value, digits[sizeof (unsigned long) * CHAR_BIT];
+  char *nptr;
+  int count;
 
-  /* Initial checks. */
-  cmp_res = bc_compare (*num, _zero_);
-  if (cmp_res < 0)
-    return 0;           /* error */
-  else
-  {
-    if (cmp_res == 0)
-    {
-      bc_free_num (num);
-      *num = bc_copy_num (_zero_);
-      return 1;
-    }
-  }
-  cmp_res = bc_compare (*num, _one_);
-  if (cmp_res == 0)
+  value = 0;
+  nptr = num->n_value;
+  for (count = num->n_len; count > 0; count--)
+    value = value * BASE + *nptr++;
+
+  for (count = 0; width < 0 ? value != 0 : count < width; count++)
   {
-    bc_free_num (num);
-    *num = bc_copy_num (_one_);
-    return 1;
+    digits[count] = value % out->base;
+    value /= out->base;
   }
+  while (count-- > 0)
+    _bc_out_digit (out, digits[count]);
+}
 
-  /* Initialize the variables. */
-  rscale = MAX (scale, (*num)->n_scale);
-  bc_init_num(&guess);
-  bc_init_num(&guess1);
-  bc_init_num(&diff);
-  point5 = bc_new_num (1, 1);
-  point5->n_value[1] = 5;
+/* Send the integer NUM, at least zero, as exactly WIDTH digits, or as
+   few as it takes if WIDTH is negative. */
 
+static void _bc_out_int (bc_out_state *out, bc_num num, int width)
+{
+  bc_num quot, rem;
+  int level, low;
 
-  /* Calculate the initial guess. */
-  if (cmp_res < 0)
+  if (width < 0)
   {
-    /* The number is between 0 and 1.  Guess should start at 1. */
-    bc_free_num (&guess); // fix memory leak
-    guess = bc_copy_num (_one_);
-    cscale = (*num)->n_scale;
+    /* Split below the first power NUM is under. */
+    for (level = 0; level < RADIX_LEVELS - 1
+                    && bc_compare (num, _bc_radix_pow (level)) >= 0; level++)
+      ;
+    if (level == 0)
+    {
+      _bc_out_leaf (out, num, -1);
+      return;
+    }
+    level--;
   }
   else
   {
-    /* The number is greater than 1.  Guess should start at 10^(exp/2). */
-    bc_int2num (&guess, 10);
-
-    bc_int2num (&guess1, (*num)->n_len);
-    bc_multiply (guess1, point5, &guess1, 0);
-    guess1->n_scale = 0;
-    bc_raise (guess, guess1, &guess, 0);
-    bc_free_num (&guess1);
-    cscale = 3;
-  }
-
-  /* Find the square root using Newton's algorithm. */
-  done = FALSE;
-  while (!done)
-  {
-    bc_free_num (&guess1);
-    guess1 = bc_copy_num (guess);
-    bc_divide (*num, guess, &guess, cscale);
-    bc_add (guess, guess1, &guess, 0);
-    bc_multiply (guess, point5, &guess, cscale);
-    bc_sub (guess, guess1, &diff, cscale + 1);
-    if (bc_is_near_zero (diff, cscale))
+    if (width <= _bc_radix.leaf)
     {
-      if (cscale < rscale + 1)
-        cscale = MIN (cscale * 3, rscale + 1);
-      else
-        done = TRUE;
+      _bc_out_leaf (out, num, width);
+      return;
     }
+    for (level = 0; (_bc_radix.leaf << (level + 1)) < width; level++)
+      ;
   }
 
-  /* Assign the number and clean up. */
-  bc_free_num (num);
-  bc_divide (guess, _one_, num, rscale);
-  bc_free_num (&guess);
-  bc_free_num (&guess1);
-  bc_free_num (&point5);
-  bc_free_num (&diff);
-  return 1;
+  low = _bc_radix.leaf << level;
+  quot = NULL;
+  rem = NULL;
+  bc_divmod (num, _bc_radix_pow (level), &quot, &rem, 0);
+  _bc_out_int (out, quot, width < 0 ? -1 : width - low);
+  _bc_out_int (out, rem, low);
+  bc_free_num (&quot);
+  bc_free_num (&rem);
 }
 
-/* Convert a number NUM to a long.  The function returns only the integer
-   part of the number.  For numbers that are too large to represent as
-   a long, this function returns a zero.  This can be detected by checking
-   the NUM for zero after having a zero returned. */
+/* Send NUM in base O_BASE (2 or more) to OUT_CHAR, as bc prints it:
+   digits up to 16 as 0-9 and A-F, bigger ones as space separated
+   decimal numbers.  The fraction gets as many digits as it takes for
+   the last one to be worth less than 10^-scale.  A zero prints as
+   nothing before the point unless LEADING_ZERO. */
 
-long bc_num2long (bc_num num) {
-  long val;
+void bc_out_num (bc_num num, int o_base, void (* out_char)(int),
+                 int leading_zero)
+{
+  bc_out_state out;
+  bc_num int_part, frac_part, power, next;
   char *nptr;
-  int  index;
-
-  /* Extract the int value, ignore the fraction. */
-  val = 0;
-  nptr = num->n_value;
-  for (index = num->n_len; (index > 0) && (val <= (LONG_MAX / BASE)); index--)
-    val = val * BASE + *nptr++;
-
-  /* Check for overflow.  If overflow, return zero. */
-  if (index > 0) val = 0;
-  if (val < 0) val = 0;
+  int index, digits, level;
 
-  /* Return the value. */
-  if (num->n_sign == PLUS)
-    return (val);
-  else
-    return (-val);
-}
+  /* The negative sign if needed. */
+  if (num->n_sign == MINUS) (*out_char) ('-');
 
+  if (o_base == 10)
+  {
+    nptr = num->n_value;
+    if (num->n_len > 1 || *nptr != 0)
+      for (index = num->n_len; index > 0; index--)
+        (*out_char) (BCD_CHAR (*nptr++));
+    else
+      nptr++;
 
-/* Convert an integer VAL to a bc number NUM. */
+    if (leading_zero && bc_is_zero (num))
+      (*out_char) ('0');
 
-void bc_int2num (bc_num *num, int val)
-{
-  char buffer[30];
-  char *bptr, *vptr;
-  int  ix = 1;
-  char neg = 0;
+    if (num->n_scale > 0)
+    {
+      (*out_char) ('.');
+      for (index = 0; index < num->n_scale; index++)
+        (*out_char) (BCD_CHAR (*nptr++));
+    }
+    return;
+  }
 
-  /* Sign. */
-  if (val < 0)
+  if (leading_zero && bc_is_zero (num))
+    (*out_char) ('0');
+
+  _bc_radix_base (o_base);
+  out.out_char = out_char;
+  out.base = o_base;
+  for (out.width = 1, index = o_base - 1; index >= BASE; index /= BASE)
+    out.width++;
+
+  /* The integer part. */
+  int_part = bc_new_num (num->n_len, 0);
+  memcpy (int_part->n_value, num->n_value, num->n_len);
+  out.space = TRUE;
+  if (!bc_is_zero (int_part))
+    _bc_out_int (&out, int_part, -1);
+  bc_free_num (&int_part);
+
+  if (num->n_scale == 0) return;
+  (*out_char) ('.');
+
+  /* The fraction gets the first K digits, for the smallest K with
+     o_base^K longer than num->n_scale digits.  Find the largest power
+     that is not, from the radix tree down and then a digit at a time. */
+  power = bc_copy_num (_one_);
+  next = NULL;
+  digits = 0;
+  for (level = 0; _bc_radix_pow (level)->n_len <= num->n_scale; level++)
+    ;
+  while (level-- > 0)
   {
-    neg = 1;
-    val = -val;
+    bc_multiply (power, _bc_radix_pow (level), &next, 0);
+    if (next->n_len <= num->n_scale)
+    {
+      bc_free_num (&power);
+      power = next;
+      next = NULL;
+      digits += _bc_radix.leaf << level;
+    }
   }
-
-  /* Get things going. */
-  bptr = buffer;
-  *bptr++ = val % BASE;
-  val = val / BASE;
-
-  /* Extract remaining digits. */
-  while (val != 0)
+  for (;;)
   {
-    *bptr++ = val % BASE;
-    val = val / BASE;
-    ix++;             /* Count the digits. */
+    bc_mul_small (power, o_base, &power);
+    digits++;
+    if (power->n_len > num->n_scale) break;
   }
-
-  /* Make the number. */
-  bc_free_num (num);
-  *num = bc_new_num (ix, 0);
-  if (neg) (*num)->n_sign = MINUS;
-
-  /* Assign the digits. */
-  vptr = (*num)->n_value;
-  while (ix-- > 0)
-    *vptr++ = *--bptr;
+  bc_free_num (&next);
+
+  /* floor (fraction * o_base^K), in K digits. */
+  frac_part = bc_new_num (1, num->n_scale);
+  memcpy (frac_part->n_value + 1, num->n_value + num->n_len, num->n_scale);
+  bc_multiply (frac_part, power, &frac_part, 0);
+  int_part = bc_new_num (frac_part->n_len, 0);
+  memcpy (int_part->n_value, frac_part->n_value, frac_part->n_len);
+  out.space = FALSE;
+  _bc_out_int (&out, int_part, digits);
+
+  bc_free_num (&int_part);
+  bc_free_num (&frac_part);
+  bc_free_num (&power);
 }
 
-/* Convert a numbers to a string.  Base 10 only.*/
-char *num2str (bc_num num)
-{
-  char *str, *sptr;
-  char *nptr;
-  int  index, signch;
+/* The value of the digit CH, or 99 if it is not one. */
 
-  /* Allocate the string memory. */
-  signch = ( num->n_sign == PLUS ? 0 : 1 );  /* Number of sign chars. */
-  if (num->n_scale > 0)
-    str = (char *) malloc (num->n_len + num->n_scale + 2 + signch);
-  else
-    str = (char *) malloc (num->n_len + 1 + signch);
-  if (str == NULL) bc_out_of_memory();
+static int _bc_digit_value (char ch)
+{
+  if (ch >= '0' && ch <= '9') return ch - '0';
+  if (ch >= 'A' && ch <= 'Z') return ch - 'A' + 10;
+  if (ch >= 'a' && ch <= 'z') return ch - 'a' + 10;
+  return 99;
+}
 
-  /* The negative sign if needed. */
-  sptr = str;
-  if (signch) *sptr++ = '-';
+/* RESULT = the LEN base _bc_radix.base digits at DIGITS. */
 
-  /* Load the whole number. */
-  nptr = num->n_value;
-  for (index = num->n_len; index > 0; index--)
-    *sptr++ = BCD_CHAR(*nptr++);
+static void _bc_in_int (const char *digits, int len, bc_num *result)
+{
+  bc_num high;
+  unsigned long value;
+  int level, low;
 
-  /* Now the fraction. */
-  if (num->n_scale > 0)
+  bc_free_num (result);
+  if (len <= _bc_radix.leaf)
   {
-    *sptr++ = '.';
-    for (index = 0; index < num->n_scale; index++)
-      *sptr++ = BCD_CHAR(*nptr++);
+    for (value = 0; len > 0; len--)
+      value = value * _bc_radix.base + _bc_digit_value (*digits++);
+    *result = _bc_ulong_num (value);
+    return;
   }
 
-  /* Terminate the string and return it! */
-  *sptr = '\0';
-  return (str);
+  for (level = 0; (_bc_radix.leaf << (level + 1)) < len; level++)
+    ;
+  low = _bc_radix.leaf << level;
+  high = NULL;
+  _bc_in_int (digits, len - low, &high);
+  _bc_in_int (digits + len - low, low, result);
+  bc_multiply (high, _bc_radix_pow (level), &high, 0);
+  bc_add (high, *result, result, 0);
+  bc_free_num (&high);
 }
-/* Convert strings to bc numbers.  Base 10 only.*/
 
-void bc_str2num (bc_num *num, const char *str, int scale)
+/* Convert STR, digits in base BASE (2 to 36, with A to Z or a to z for
+   ten and up) with an optional sign and point, to NUM with SCALE digits
+   after the decimal point.  Returns -1, making NUM zero, if STR is not
+   such a number. */
+
+int bc_str2num_base (bc_num *num, const char *str, int base, int scale)
 {
-  int digits, strscale;
-  const char *ptr;
-  char *nptr;
-  char zero_int;
+  bc_num frac, power, expo;
+  const char *ptr, *int_digits, *frac_digits;
+  int int_len, frac_len;
+  sign n_sign;
 
-  /* Prepare num. */
   bc_free_num (num);
 
-  /* Check for valid number and count digits. */
+  /* Check for a valid number and count digits. */
   ptr = str;
-  digits = 0;
-  strscale = 0;
-  zero_int = FALSE;
-  if ( (*ptr == '+') || (*ptr == '-'))  ptr++;  /* Sign */
-  while (*ptr == '0') ptr++;                    /* Skip leading zeros. */
-  while (isdigit((int)*ptr)) ptr++, digits++;   /* digits */
-  if (*ptr == '.') ptr++;                       /* decimal point */
-  while (isdigit((int)*ptr)) ptr++, strscale++; /* digits */
-  if ((*ptr != '\0') || (digits + strscale == 0))
+  n_sign = (*ptr == '-' ? MINUS : PLUS);
+  if ((*ptr == '+') || (*ptr == '-')) ptr++;
+  int_digits = ptr;
+  while (_bc_digit_value (*ptr) < base) ptr++;
+  int_len = ptr - int_digits;
+  if (*ptr == '.') ptr++;
+  frac_digits = ptr;
+  while (_bc_digit_value (*ptr) < base) ptr++;
+  frac_len = ptr - frac_digits;
+  if (base < 2 || base > 36 || *ptr != '\0' || int_len + frac_len == 0)
   {
     *num = bc_copy_num (_zero_);
-    return;
+    return -1;
   }
 
-  /* Adjust numbers and allocate storage and initialize fields. */
-  strscale = MIN(strscale, scale);
-  if (digits == 0)
+  if (base == 10)
   {
-    zero_int = TRUE;
-    digits = 1;
+    bc_str2num (num, str, scale);
+    return 0;
   }
-  *num = bc_new_num (digits, strscale);
 
-  /* Build the whole number. */
-  ptr = str;
-  if (*ptr == '-')
-  {
-    (*num)->n_sign = MINUS;
-    ptr++;
-  }
-  else
-  {
-    (*num)->n_sign = PLUS;
-    if (*ptr == '+') ptr++;
-  }
-  while (*ptr == '0') ptr++;                    /* Skip leading zeros. */
-  nptr = (*num)->n_value;
-  if (zero_int)
+  _bc_radix_base (base);
+  *num = NULL;
+  _bc_in_int (int_digits, int_len, num);
+  if (frac_len > 0)
   {
-    *nptr++ = 0;
-    digits = 0;
+    /* The fraction digits as an integer, over base^frac_len. */
+    frac = NULL;
+    power = NULL;
+    expo = NULL;
+    _bc_in_int (frac_digits, frac_len, &frac);
+    bc_int2num (&power, base);
+    bc_int2num (&expo, frac_len);
+    bc_raise (power, expo, &power, 0);
+    bc_divide (frac, power, &frac, scale);
+    bc_add (*num, frac, num, 0);
+    bc_free_num (&frac);
+    bc_free_num (&power);
+    bc_free_num (&expo);
   }
-  for (; digits > 0; digits--)
-    *nptr++ = CH_VAL(*ptr++);
+  if (!bc_is_zero (*num))
+    (*num)->n_sign = n_sign;
+  return 0;
+}
 
+/* Contexts.  The package's own context starts out with the built in
+   crossovers and nothing else until bc_init_numbers. */
 
-  /* Build the fractional part. */
-  if (strscale > 0)
-  {
-    ptr++;  /* skip the decimal point! */
-    for (; strscale > 0; strscale--)
-      *nptr++ = CH_VAL(*ptr++);
-  }
+static bc_context _bc_default_context =
+{
+  NULL, NULL, NULL, 0,
+  MUL_BASE_DIGITS, MUL_TOOM3_DIGITS, MUL_NTT_DIGITS,
+  DIV_NEWTON_DIGITS, DIV_BZ_DIGITS,
+  MUL_FORK_DEPTH, MUL_FORK_DIGITS,
+  { NULL }, { 0 }, 0, 0,
+  { 0, 0, 0, { NULL } },
+  { NULL }, { 0 }
+};
+
+BC_THREAD_LOCAL bc_context *bc_current = &_bc_default_context;
+
+/* Set up CTX as a new context: the special numbers, scale 0, the built
+   in crossovers and empty pools and caches. */
+
+void bc_init_context (bc_context *ctx)
+{
+  bc_context *prev;
+
+  memset (ctx, 0, sizeof (bc_context));
+  ctx->c_mul_base_digits = MUL_BASE_DIGITS;
+  ctx->c_mul_toom3_digits = MUL_TOOM3_DIGITS;
+  ctx->c_mul_ntt_digits = MUL_NTT_DIGITS;
+  ctx->c_div_newton_digits = DIV_NEWTON_DIGITS;
+  ctx->c_div_bz_digits = DIV_BZ_DIGITS;
+  ctx->c_fork_depth = MUL_FORK_DEPTH;
+  ctx->c_fork_digits = MUL_FORK_DIGITS;
+  prev = bc_use_context (ctx);
+  bc_init_numbers ();
+  bc_use_context (prev);
 }
 
-/* Added by NJG to remove a memory leak */
+/* Free everything CTX holds.  Numbers still sharing its special numbers
+   must be freed first.  The crossovers and scale are kept, so making
+   CTX current and calling bc_init_numbers sets it up again. */
 
-void
-bc_free_numbers (void)
+void bc_free_context (bc_context *ctx)
 {
+  bc_context *prev;
+  int indx;
+
+  prev = bc_use_context (ctx);
   bc_free_num (&_zero_);
   bc_free_num (&_one_);
   bc_free_num (&_two_);
+  for (indx = 0; indx < BC_MATH_CONSTS; indx++)
+    bc_free_num (&ctx->c_math[indx]);
+  _bc_radix_free ();
+  bc_pool_trim ();
+  bc_use_context (prev);
+}
+
+/* Make CTX the current context of the calling thread, or the package's
+   own if CTX is NULL.  Returns the one that was current, for putting
+   it back. */
+
+bc_context *bc_use_context (bc_context *ctx)
+{
+  bc_context *prev = bc_current;
+
+  bc_current = (ctx != NULL ? ctx : &_bc_default_context);
+  return prev;
+}
+
+/* Added by NJG to remove a memory leak */
 
+void
+bc_free_numbers (void)
+{
+  bc_free_context (bc_current);
 }
 
 // error handler - replace this for different error handling
@@ -43,6 +43,13 @@
 
 typedef enum {PLUS, MINUS} sign;
 
+/* Digits stored inside the number header itself.  Numbers with up to this
+   many digits (n_len + n_scale) take one small block. */
+
+#ifndef BC_INLINE_DIGITS
+#define BC_INLINE_DIGITS 24
+#endif
+
 typedef struct bc_struct *bc_num;
 
 typedef struct bc_struct
@@ -59,8 +66,102 @@ typedef struct bc_struct
   char *n_value;	/* The number. Not zero char terminated.
 			   May not point to the same place as n_ptr as
 			   in the case of leading zeros generated. */
+  int   n_alloc;	/* Digits of room at n_inline. */
+  char  n_inline[BC_INLINE_DIGITS];	/* Start of the digits owned by this
+			   number.  Longer numbers are allocated with
+			   the array running past the end of the struct. */
 } bc_struct;
 
+/* A modulus made ready for repeated reductions, see bc_init_modctx. */
+
+typedef struct bc_modctx
+{
+  bc_num m_mod;		/* The modulus, a positive integer. */
+  bc_num m_mu;		/* floor (10^(2 m_len) / m_mod), for Barrett
+			   reduction. */
+  int    m_len;		/* Digits in m_mod. */
+} bc_modctx;
+
+/* A column of numbers of one shape, stored structure of arrays for the
+   batch routines (bc_add_batch ...).  Digit POS (0 is the most
+   significant) of number I is b_digits[POS * b_count + I], so each
+   digit position is a contiguous row across the numbers.  Leading
+   zeros are kept, up to b_len integer digits. */
+
+typedef struct bc_batch
+{
+  int    b_count;	/* Numbers in the column. */
+  int    b_len;		/* Integer digits of each. */
+  int    b_scale;	/* Digits after the decimal point of each. */
+  char  *b_digits;	/* (b_len + b_scale) rows of b_count digits. */
+  char  *b_signs;	/* The sign of each, PLUS or MINUS. */
+} bc_batch;
+
+/* Allocation pool counters, see bc_pool_stats. */
+
+typedef struct bc_pool_stat
+{
+  unsigned long hits;	/* Blocks handed out from a free list. */
+  unsigned long misses;	/* Blocks that had to come from malloc. */
+  int   cached;		/* Blocks currently held on the free lists. */
+} bc_pool_stat;
+
+/* Storage class of the current context pointer, one per thread where
+   the compiler has thread local storage. */
+
+#ifndef BC_THREAD_LOCAL
+#if defined(__AVR__)
+#define BC_THREAD_LOCAL
+#elif defined(__GNUC__)
+#define BC_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define BC_THREAD_LOCAL __declspec(thread)
+#else
+#define BC_THREAD_LOCAL
+#endif
+#endif
+
+#define BC_POOL_CLASSES 4	/* Size classes kept on free lists. */
+#define BC_RADIX_LEVELS 32	/* Powers kept for base conversion. */
+#define BC_MATH_CONSTS 3	/* Constants kept by bcmath.c. */
+
+/* Everything the package keeps between calls: the special numbers, a
+   scale for clients that want one, the multiply and divide crossovers,
+   the allocation pools and the conversion and constant caches.  Every
+   call works in the current context of the calling thread, see
+   bc_use_context, so threads that each use a context of their own share
+   nothing and need no locking.  A number may share the special numbers
+   of the context it was made in (bc_init_num makes a copy of zero), so
+   it must be freed before that context is. */
+
+typedef struct bc_context
+{
+  bc_num c_zero;	/* The special numbers 0, 1 and 2. */
+  bc_num c_one;
+  bc_num c_two;
+  int    c_scale;	/* Scale used by BigNumber. */
+  int    c_mul_base_digits;	/* Multiply crossovers, see */
+  int    c_mul_toom3_digits;	/* bc_set_mul_digits. */
+  int    c_mul_ntt_digits;
+  int    c_div_newton_digits;	/* Divide crossovers. */
+  int    c_div_bz_digits;
+  int    c_fork_depth;	/* Multiply levels that fork, see */
+  int    c_fork_digits;	/* bc_set_mul_fork. */
+  bc_num c_pool[BC_POOL_CLASSES];	/* Freed blocks, by size class. */
+  int    c_pool_count[BC_POOL_CLASSES];
+  unsigned long c_pool_hits;
+  unsigned long c_pool_misses;
+  struct
+  {
+    int    base;		/* 0 when nothing is kept. */
+    int    leaf;		/* k, digits in an unsigned long. */
+    int    levels;	/* Powers made so far. */
+    bc_num pow[BC_RADIX_LEVELS];	/* pow[i] = base^(leaf 2^i) */
+  } c_radix;		/* Powers of the last base converted. */
+  bc_num c_math[BC_MATH_CONSTS];	/* Constants kept by bcmath.c, */
+  int    c_math_scale[BC_MATH_CONSTS];	/* good to this many digits. */
+} bc_context;
+
 
 /* The base used in storing the numbers in n_value above.
    Currently this MUST be 10. */
@@ -90,10 +191,9 @@ typedef struct bc_struct
 #endif
 
 
-/* Global numbers. */
-extern bc_num _zero_;
-extern bc_num _one_;
-extern bc_num _two_;
+/* The current context of this thread.  Until bc_use_context is called
+   it is one the package keeps itself, which bc_init_numbers sets up. */
+extern BC_THREAD_LOCAL bc_context *bc_current;
 
 
 /* Function Prototypes */
@@ -108,17 +208,41 @@ _PROTOTYPE(void bc_init_numbers, (void));
 
 _PROTOTYPE(void bc_free_numbers, (void));
 
+_PROTOTYPE(void bc_init_context, (bc_context *ctx));
+
+_PROTOTYPE(void bc_free_context, (bc_context *ctx));
+
+_PROTOTYPE(bc_context *bc_use_context, (bc_context *ctx));
+
 _PROTOTYPE(bc_num bc_new_num, (int length, int scale));
 
 _PROTOTYPE(void bc_free_num, (bc_num *num));
 
+_PROTOTYPE(void bc_pool_stats, (bc_pool_stat *stats));
+
+_PROTOTYPE(void bc_pool_trim, (void));
+
+_PROTOTYPE(void bc_set_mul_digits, (int base, int toom3, int ntt));
+
+_PROTOTYPE(void bc_get_mul_digits, (int *base, int *toom3, int *ntt));
+
+_PROTOTYPE(void bc_set_mul_fork, (int depth, int digits));
+
+_PROTOTYPE(int bc_start_threads, (int count));
+
+_PROTOTYPE(void bc_stop_threads, (void));
+
 _PROTOTYPE(bc_num bc_copy_num, (bc_num num));
 
 _PROTOTYPE(void bc_init_num, (bc_num *num));
 
 _PROTOTYPE(void bc_str2num, (bc_num *num, const char *str, int scale));
+_PROTOTYPE(void bc_str2num_n, (bc_num *num, const char *str, int len,
+                              int scale));
 
 _PROTOTYPE(char *bc_num2str, (bc_num num));
+_PROTOTYPE(int bc_num2str_into, (bc_num num, char *buf, int len,
+                                 int *needed));
 
 _PROTOTYPE(void bc_int2num, (bc_num *num, int val));
 
@@ -138,6 +262,8 @@ _PROTOTYPE(void bc_sub, (bc_num n1, bc_num n2, bc_num *result, int scale_min));
 
 _PROTOTYPE(void bc_multiply, (bc_num n1, bc_num n2, bc_num *prod, int scale));
 
+_PROTOTYPE(void bc_square, (bc_num num, bc_num *prod, int scale));
+
 _PROTOTYPE(int bc_divide, (bc_num n1, bc_num n2, bc_num *quot, int scale));
 
 _PROTOTYPE(int bc_modulo, (bc_num num1, bc_num num2, bc_num *result,
@@ -152,9 +278,54 @@ _PROTOTYPE(int bc_raisemod, (bc_num base, bc_num expo, bc_num mod,
 _PROTOTYPE(void bc_raise, (bc_num num1, bc_num num2, bc_num *result,
                            int scale));
 
+_PROTOTYPE(int bc_init_modctx, (bc_modctx *ctx, bc_num mod));
+
+_PROTOTYPE(void bc_free_modctx, (bc_modctx *ctx));
+
+_PROTOTYPE(void bc_modctx_reduce, (bc_modctx *ctx, bc_num num,
+                                   bc_num *result));
+
+_PROTOTYPE(void bc_modctx_multiply, (bc_modctx *ctx, bc_num n1, bc_num n2,
+                                     bc_num *result));
+
+_PROTOTYPE(int bc_modctx_raise, (bc_modctx *ctx, bc_num base, bc_num expo,
+                                 bc_num *result));
+
 _PROTOTYPE(int bc_sqrt, (bc_num *num, int scale));
 
+_PROTOTYPE(void bc_shift10, (bc_num num, int places, bc_num *result));
+
+_PROTOTYPE(void bc_mul_small, (bc_num num, unsigned long val,
+                               bc_num *result));
+
+_PROTOTYPE(int bc_div_small, (bc_num num, unsigned long val, bc_num *quot,
+                              unsigned long *rem, int scale));
+
+_PROTOTYPE(void bc_add_small, (bc_num num, unsigned long val,
+                               bc_num *result, int scale_min));
+
+_PROTOTYPE(void bc_batch_init, (bc_batch *batch, int count, int len,
+                                int scale));
+
+_PROTOTYPE(void bc_batch_free, (bc_batch *batch));
+
+_PROTOTYPE(int bc_batch_set, (bc_batch *batch, int indx, bc_num num));
+
+_PROTOTYPE(void bc_batch_get, (const bc_batch *batch, int indx,
+                               bc_num *num));
+
+_PROTOTYPE(int bc_add_batch, (const bc_batch *n1, const bc_batch *n2,
+                              bc_batch *result));
+
+_PROTOTYPE(int bc_sub_batch, (const bc_batch *n1, const bc_batch *n2,
+                              bc_batch *result));
+
+_PROTOTYPE(int bc_mul_batch, (const bc_batch *n1, const bc_batch *n2,
+                              bc_batch *result));
+
 _PROTOTYPE(void bc_out_num, (bc_num num, int o_base, void (* out_char)(int),
                              int leading_zero));
+_PROTOTYPE(int bc_str2num_base, (bc_num *num, const char *str, int base,
+                                 int scale));
 
 #endif
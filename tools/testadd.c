@@ -0,0 +1,122 @@
+/*
+  testadd.c
+  Times bc_add, bc_sub and bc_compare of number.c on 100 to 100000
+  digit operands.  The digit kernels are picked at compile time, so
+  the Makefile builds it three times (make addspeed): scalar
+  (-DBC_NO_SIMD), SSE2 (plain x86-64) and AVX2 (-mavx2).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bcconfig.h"
+#include "number.h"
+
+#define MIN_SECONDS 0.05        /* Time each operation at least this long, */
+#define TRIES 3                 /* this many times, and keep the best. */
+
+/* The kernels number.c picks for these flags, see BC_SIMD there. */
+#if defined(BC_NO_SIMD) || !defined(__SSE2__)
+#define KERNELS "scalar"
+#elif defined(__AVX2__)
+#define KERNELS "avx2"
+#else
+#define KERNELS "sse2"
+#endif
+
+enum { OP_ADD, OP_SUB, OP_CMP };
+
+static const char *op_names[] = { "add", "sub", "cmp" };
+
+/* Make a random integer of DIGITS digits from SEED, ending in LAST.
+   Two numbers from the same seed differ only in their last digit,
+   which makes bc_compare look at every digit. */
+
+static bc_num random_num (int digits, unsigned seed, int last)
+{
+  bc_num num;
+  char *str;
+  int indx;
+
+  srand (seed);
+  str = (char *) malloc (digits + 1);
+  str[0] = '1' + rand () % 9;
+  for (indx = 1; indx < digits; indx++)
+    str[indx] = '0' + rand () % 10;
+  str[digits - 1] = '0' + last;
+  str[digits] = 0;
+  num = NULL;
+  bc_str2num (&num, str, 0);
+  free (str);
+  return num;
+}
+
+/* Seconds per operation OP on two DIGITS digit numbers, the best of
+   TRIES timings. */
+
+static double time_op (int op, int digits)
+{
+  bc_num n1, n2, result;
+  clock_t start, elapsed;
+  double best, secs;
+  long reps;
+  int try, sink;
+
+  n1 = random_num (digits, digits, 7);
+  n2 = random_num (digits, op == OP_CMP ? digits : digits + 1, 3);
+  bc_init_num (&result);
+  best = 0;
+  sink = 0;
+  for (try = 0; try < TRIES; try++)
+  {
+    reps = 0;
+    start = clock ();
+    do
+    {
+      switch (op)
+      {
+      case OP_ADD:
+        bc_add (n1, n2, &result, 0);
+        break;
+      case OP_SUB:
+        bc_sub (n1, n2, &result, 0);
+        break;
+      default:
+        sink += bc_compare (n1, n2);
+        break;
+      }
+      reps++;
+      elapsed = clock () - start;
+    } while (elapsed < MIN_SECONDS * CLOCKS_PER_SEC);
+    secs = (double) elapsed / CLOCKS_PER_SEC / reps;
+    if (try == 0 || secs < best)
+      best = secs;
+  }
+  if (op == OP_CMP && sink == 0)
+    fprintf (stderr, "compare found no difference\n");
+  bc_free_num (&n1);
+  bc_free_num (&n2);
+  bc_free_num (&result);
+  return best;
+}
+
+int main (void)
+{
+  static const int sizes[] = { 100, 1000, 10000, 100000 };
+  int op, indx;
+
+  bc_init_numbers ();
+
+  printf ("us per op     ");
+  for (indx = 0; indx < 4; indx++)
+    printf (" n=%-8d", sizes[indx]);
+  printf ("\n");
+  for (op = OP_ADD; op <= OP_CMP; op++)
+  {
+    printf ("%s %-8s  ", op_names[op], KERNELS);
+    for (indx = 0; indx < 4; indx++)
+      printf (" %9.3f ", time_op (op, sizes[indx]) * 1e6);
+    printf ("\n");
+  }
+  return 0;
+}
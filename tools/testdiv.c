@@ -0,0 +1,249 @@
+/*
+  testdiv.c
+  Times bc_divide and bc_divmod of number.c with Knuth's divide, the
+  Burnikel-Ziegler divide and Newton's reciprocal divide, and measures
+  where each one starts to win, to check DIV_BZ_DIGITS and
+  DIV_NEWTON_DIGITS.  Build it with the same compiler flags as the
+  library (see Makefile).  An argument caps the divisor length of the
+  Newton search (default 400000 digits, 0 skips it).
+  It also checks that the three methods agree on all-nines operands,
+  and that no divide leaks a reference to _zero_; it exits 1 if not.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "bcconfig.h"
+#include "number.h"
+
+#define MIN_SECONDS 0.01        /* Time each divide at least this long, */
+#define TRIES 3                 /* this many times, and keep the best. */
+#define WINS 3                  /* Sizes in a row the new method must win. */
+#define OFF INT_MAX             /* Threshold that keeps a method out. */
+
+enum { KNUTH, BZ, NEWTON };
+
+/* Make a random integer of DIGITS digits. */
+
+static bc_num random_num (int digits)
+{
+  bc_num num;
+  char *str;
+  int indx;
+
+  str = (char *) malloc (digits + 1);
+  str[0] = '1' + rand () % 9;
+  for (indx = 1; indx < digits; indx++)
+    str[indx] = '0' + rand () % 10;
+  str[digits] = 0;
+  num = NULL;
+  bc_str2num (&num, str, 0);
+  free (str);
+  return num;
+}
+
+/* Make the integer 10^DIGITS - 1. */
+
+static bc_num nines_num (int digits)
+{
+  bc_num num;
+  char *str;
+
+  str = (char *) malloc (digits + 1);
+  memset (str, '9', digits);
+  str[digits] = 0;
+  num = NULL;
+  bc_str2num (&num, str, 0);
+  free (str);
+  return num;
+}
+
+/* Make bc_divide use METHOD. */
+
+static void use_method (int method)
+{
+  div_bz_digits = method == BZ ? 0 : OFF;
+  div_newton_digits = method == NEWTON ? 0 : OFF;
+}
+
+/* Seconds per divide of a NLEN digit number by a DLEN digit one with
+   METHOD, the best of TRIES timings.  With DIVMOD set it times
+   bc_divmod (quotient and remainder), else bc_divide. */
+
+static double time_div (int nlen, int dlen, int method, int divmod)
+{
+  bc_num n1, n2, quot, rem;
+  clock_t start, elapsed;
+  double best, secs;
+  long reps;
+  int try;
+
+  use_method (method);
+  n1 = random_num (nlen);
+  n2 = random_num (dlen);
+  bc_init_num (&quot);
+  bc_init_num (&rem);
+  best = 0;
+  for (try = 0; try < TRIES; try++)
+  {
+    reps = 0;
+    start = clock ();
+    do
+    {
+      if (divmod)
+        bc_divmod (n1, n2, &quot, &rem, 0);
+      else
+        bc_divide (n1, n2, &quot, 0);
+      reps++;
+      elapsed = clock () - start;
+    } while (elapsed < MIN_SECONDS * CLOCKS_PER_SEC);
+    secs = (double) elapsed / CLOCKS_PER_SEC / reps;
+    if (try == 0 || secs < best)
+      best = secs;
+  }
+  bc_free_num (&n1);
+  bc_free_num (&n2);
+  bc_free_num (&quot);
+  bc_free_num (&rem);
+  return best;
+}
+
+/* Grow the divisor from START by STEP percent up to LIMIT digits, with
+   a dividend twice as long, timing bc_divide with OLD and with NEW.
+   The crossover is the first divisor length where NEW wins WINS times
+   in a row.  Returns it, or OFF if there is none. */
+
+static int crossover (const char *name, int start, int step, int limit,
+                      int old, int new)
+{
+  int digits, wins, found;
+  double t_old, t_new;
+
+  wins = 0;
+  found = OFF;
+  for (digits = start; digits <= limit; digits += digits * step / 100 + 1)
+  {
+    t_old = time_div (2 * digits, digits, old, 0);
+    t_new = time_div (2 * digits, digits, new, 0);
+    fprintf (stderr, "%s %6d digits: %12.1f us %12.1f us\n", name, digits,
+             t_old * 1e6, t_new * 1e6);
+    if (t_new < t_old)
+    {
+      if (wins++ == 0)
+        found = digits;
+      if (wins == WINS)
+        break;
+    }
+    else
+      wins = 0;
+  }
+  if (wins < WINS)
+    found = OFF;
+  return found;
+}
+
+/* Divide all-nines numbers, whose quotient digits are estimated as
+   10^h - 1 in Burnikel-Ziegler, with each method.  Returns FALSE if
+   a method gets a different quotient or remainder than Knuth's. */
+
+static int check_nines (void)
+{
+  static const int shapes[][3] =
+  {
+    { 213, 222, 147 }, { 600, 300, 0 }, { 1000, 999, 20 }, { 2000, 64, 5 }
+  };
+  bc_num n1, n2, quot[3], rem[3];
+  int shape, method, same;
+
+  same = TRUE;
+  for (shape = 0; shape < 4; shape++)
+  {
+    n1 = nines_num (shapes[shape][0]);
+    n2 = nines_num (shapes[shape][1]);
+    for (method = KNUTH; method <= NEWTON; method++)
+    {
+      use_method (method);
+      bc_init_num (&quot[method]);
+      bc_init_num (&rem[method]);
+      bc_divide (n1, n2, &quot[method], shapes[shape][2]);
+      if (bc_compare (quot[method], quot[KNUTH]) != 0)
+        same = FALSE;
+      bc_divmod (n1, n2, &quot[method], &rem[method], shapes[shape][2]);
+      if (bc_compare (quot[method], quot[KNUTH]) != 0
+          || bc_compare (rem[method], rem[KNUTH]) != 0)
+        same = FALSE;
+    }
+    for (method = KNUTH; method <= NEWTON; method++)
+    {
+      bc_free_num (&quot[method]);
+      bc_free_num (&rem[method]);
+    }
+    bc_free_num (&n1);
+    bc_free_num (&n2);
+  }
+  return same;
+}
+
+static void report (const char *name, int found, int current)
+{
+  if (found == OFF)
+    printf ("%s never won in the range tried", name);
+  else
+    printf ("%s wins from %d digits", name, found);
+  if (current == OFF)
+    printf (" (built in: off)\n");
+  else
+    printf (" (built in: %d)\n", current);
+}
+
+int main (int argc, char **argv)
+{
+  static const int sizes[] = { 200, 500, 1000, 2000, 5000, 10000 };
+  int bz, newton, limit, indx, refs;
+
+  bc_init_numbers ();
+  srand (1);
+  bz = div_bz_digits;
+  newton = div_newton_digits;
+  limit = argc > 1 ? atoi (argv[1]) : 400000;
+  refs = _zero_->n_refs;
+
+  if (!check_nines ())
+  {
+    printf ("the methods differ on all-nines operands\n");
+    return 1;
+  }
+
+  /* A few hundred to a few thousand digits, n by n/2. */
+  printf ("us per divide      knuth          bz      newton"
+          "   divmod knuth   divmod bz\n");
+  for (indx = 0; indx < 6; indx++)
+    printf ("n=%-6d %12.1f %11.1f %11.1f %14.1f %11.1f\n", sizes[indx],
+            time_div (sizes[indx], sizes[indx] / 2, KNUTH, 0) * 1e6,
+            time_div (sizes[indx], sizes[indx] / 2, BZ, 0) * 1e6,
+            time_div (sizes[indx], sizes[indx] / 2, NEWTON, 0) * 1e6,
+            time_div (sizes[indx], sizes[indx] / 2, KNUTH, 1) * 1e6,
+            time_div (sizes[indx], sizes[indx] / 2, BZ, 1) * 1e6);
+
+  /* Burnikel-Ziegler only takes divisors longer than its leaf. */
+  report ("burnikel-ziegler", crossover ("bz", 33, 10, 2000, KNUTH, BZ), bz);
+#if defined(BC_NTT)
+  if (limit > 0)
+    report ("newton", crossover ("newton", 25000, 25, limit, BZ, NEWTON),
+            newton);
+#else
+  (void) limit;
+#endif
+
+  div_bz_digits = bz;
+  div_newton_digits = newton;
+  if (_zero_->n_refs != refs)
+  {
+    printf ("divides leaked %d references to _zero_\n",
+            _zero_->n_refs - refs);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+  testmul.c
+  Measures the multiply crossovers of number.c on the build machine and
+  writes them as muldigits.h, for number.c built with MULDIGITS defined.
+  Build it with the same compiler flags as the library (see Makefile).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include "bcconfig.h"
+#include "number.h"
+
+#define MIN_SECONDS 0.01        /* Time each multiply at least this long, */
+#define TRIES 3                 /* this many times, and keep the best. */
+#define WINS 3                  /* Sizes in a row the new tier must win. */
+#define OFF INT_MAX             /* Threshold that keeps a tier out. */
+
+/* Make a random integer of DIGITS digits. */
+
+static bc_num random_num (int digits)
+{
+  bc_num num;
+  char *str;
+  int indx;
+
+  str = (char *) malloc (digits + 1);
+  str[0] = '1' + rand () % 9;
+  for (indx = 1; indx < digits; indx++)
+    str[indx] = '0' + rand () % 10;
+  str[digits] = 0;
+  num = NULL;
+  bc_str2num (&num, str, 0);
+  free (str);
+  return num;
+}
+
+/* Seconds per multiply of two DIGITS digit numbers with the given
+   crossovers, the best of TRIES timings. */
+
+static double time_mul (int digits, int base, int toom3, int ntt)
+{
+  bc_num n1, n2, prod;
+  clock_t start, elapsed;
+  double best, secs;
+  long reps;
+  int try;
+
+  bc_set_mul_digits (base, toom3, ntt);
+  n1 = random_num (digits);
+  n2 = random_num (digits);
+  bc_init_num (&prod);
+  best = 0;
+  for (try = 0; try < TRIES; try++)
+  {
+    reps = 0;
+    start = clock ();
+    do
+    {
+      bc_multiply (n1, n2, &prod, 0);
+      reps++;
+      elapsed = clock () - start;
+    } while (elapsed < MIN_SECONDS * CLOCKS_PER_SEC);
+    secs = (double) elapsed / CLOCKS_PER_SEC / reps;
+    if (try == 0 || secs < best)
+      best = secs;
+  }
+  bc_free_num (&n1);
+  bc_free_num (&n2);
+  bc_free_num (&prod);
+  return best;
+}
+
+/* Grow the operand size from START by STEP percent up to LIMIT digits,
+   timing the multiply without the new tier (OLD_*) and with it starting
+   at the operand pair (NEW_*).  The crossover is the first size where
+   the new tier wins WINS times in a row.  Returns the crossover in
+   digits of both operands together, or LIMIT * 2 if there is none.
+   The tiers are tried in _bc_rec_mul after the schoolbook cutoff, so
+   START should be above half of it. */
+
+static int crossover (const char *name, int start, int step, int limit,
+                      int tier)
+{
+  int digits, wins, found, base, toom3, ntt;
+  double t_old, t_new;
+
+  bc_get_mul_digits (&base, &toom3, &ntt);
+  wins = 0;
+  found = 2 * limit;
+  for (digits = start; digits <= limit; digits += digits * step / 100 + 1)
+  {
+    switch (tier)
+    {
+    case 0:
+      t_old = time_mul (digits, 2 * digits + 1, OFF, OFF);
+      t_new = time_mul (digits, 2 * digits - 1, OFF, OFF);
+      break;
+    case 1:
+      t_old = time_mul (digits, base, OFF, OFF);
+      t_new = time_mul (digits, base, 2 * digits, OFF);
+      break;
+    default:
+      t_old = time_mul (digits, base, toom3, OFF);
+      t_new = time_mul (digits, base, toom3, 2 * digits);
+      break;
+    }
+    fprintf (stderr, "%s %6d digits: %10.1f us %10.1f us\n", name, digits,
+             t_old * 1e6, t_new * 1e6);
+    if (t_new < t_old)
+    {
+      if (wins++ == 0)
+        found = 2 * digits;
+      if (wins == WINS)
+        break;
+    }
+    else
+      wins = 0;
+  }
+  if (wins < WINS)
+    found = 2 * limit;
+  bc_set_mul_digits (base, toom3, ntt);
+  return found;
+}
+
+int main (void)
+{
+  int base, toom3, ntt;
+
+  bc_init_numbers ();
+  srand (1);
+
+  base = crossover ("karatsuba", 8, 10, 4000, 0);
+  bc_set_mul_digits (base, OFF, OFF);
+  toom3 = crossover ("toom-3", base / 2 + 1, 25, 50000, 1);
+  bc_set_mul_digits (base, toom3, OFF);
+#if defined(BC_NTT)
+  ntt = crossover ("ntt", base / 2 + 1, 25, 100000, 2);
+#else
+  ntt = OFF;
+#endif
+
+  printf ("/* muldigits.h -- multiply crossovers measured by tools/testmul. */\n");
+  printf ("#define MUL_BASE_DIGITS %d\n", base);
+  printf ("#define MUL_TOOM3_DIGITS %d\n", toom3);
+  printf ("#define MUL_NTT_DIGITS %d\n", ntt);
+  return 0;
+}
@@ -0,0 +1,291 @@
+/*
+  teststr.c
+  Checks that bc_str2num_n, bc_str2num, bc_num2str_into and bc_num2str,
+  and the _bc_ascii_run and _bc_ascii_shift kernels under them, give
+  exactly what the scalar char-by-char code they replaced gave, on
+  random strings.  The kernels are picked at compile time, so the
+  Makefile builds it three times (make strcheck): scalar
+  (-DBC_NO_SIMD), SSE2 (plain x86-64) and AVX2 (-mavx2).  An argument
+  sets the number of strings (default 200000).  Exits 1 on the first
+  difference.
+*/
+
+#include <ctype.h>
+
+/* number.c is included, not linked, to reach its static kernels. */
+#include "number.c"
+
+#define MAX_CHARS 5000          /* Longest string tried, */
+#define BUF_CHARS (MAX_CHARS + 64) /* and room for it printed. */
+
+static unsigned long state = 1;
+
+/* A random number below N, from a xorshift generator. */
+
+static int random_below (int n)
+{
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return (int) ((state >> 8) % (unsigned long) n);
+}
+
+/* The scalar bc_str2num_n from before the ASCII kernels. */
+
+static void ref_str2num_n (bc_num *num, const char *str, int len, int scale)
+{
+  int digits, strscale;
+  const char *ptr, *end;
+  char *nptr;
+  char zero_int;
+
+  /* Prepare num. */
+  bc_free_num (num);
+
+  /* Check for valid number and count digits. */
+  ptr = str;
+  end = str + len;
+  digits = 0;
+  strscale = 0;
+  zero_int = FALSE;
+  if (ptr < end && ((*ptr == '+') || (*ptr == '-')))  ptr++;  /* Sign */
+  while (ptr < end && *ptr == '0') ptr++;       /* Skip leading zeros. */
+  while (ptr < end && isdigit((int)*ptr)) ptr++, digits++;   /* digits */
+  if (ptr < end && *ptr == '.') ptr++;          /* decimal point */
+  while (ptr < end && isdigit((int)*ptr)) ptr++, strscale++; /* digits */
+  if ((ptr < end) || (digits + strscale == 0))
+  {
+    *num = bc_copy_num (_zero_);
+    return;
+  }
+
+  /* Adjust numbers and allocate storage and initialize fields. */
+  strscale = MIN(strscale, scale);
+  if (digits == 0)
+  {
+    zero_int = TRUE;
+    digits = 1;
+  }
+  *num = bc_new_num (digits, strscale);
+
+  /* Build the whole number. */
+  ptr = str;
+  if (*ptr == '-')
+  {
+    (*num)->n_sign = MINUS;
+    ptr++;
+  }
+  else
+  {
+    (*num)->n_sign = PLUS;
+    if (*ptr == '+') ptr++;
+  }
+  while (*ptr == '0') ptr++;                    /* Skip leading zeros. */
+  nptr = (*num)->n_value;
+  if (zero_int)
+  {
+    *nptr++ = 0;
+    digits = 0;
+  }
+  for (; digits > 0; digits--)
+    *nptr++ = CH_VAL(*ptr++);
+
+
+  /* Build the fractional part. */
+  if (strscale > 0)
+  {
+    ptr++;  /* skip the decimal point! */
+    for (; strscale > 0; strscale--)
+      *nptr++ = CH_VAL(*ptr++);
+  }
+}
+
+/* The scalar bc_num2str_into from before the ASCII kernels. */
+
+static int ref_num2str_into (bc_num num, char *buf, int len, int *needed)
+{
+  char *sptr, *end, *nptr;
+  int index, signch, total;
+
+  signch = ( num->n_sign == PLUS ? 0 : 1 );  /* Number of sign chars. */
+  total = signch + num->n_len + 1;
+  if (num->n_scale > 0)
+    total += num->n_scale + 1;
+  if (needed != NULL) *needed = total;
+  if (len <= 0) return -1;
+
+  /* The negative sign if needed. */
+  sptr = buf;
+  end = buf + len - 1;
+  if (signch && sptr < end) *sptr++ = '-';
+
+  /* Load the whole number. */
+  nptr = num->n_value;
+  for (index = num->n_len; index > 0 && sptr < end; index--)
+    *sptr++ = BCD_CHAR(*nptr++);
+
+  /* Now the fraction. */
+  if (num->n_scale > 0 && sptr < end)
+  {
+    *sptr++ = '.';
+    nptr = num->n_value + num->n_len;
+    for (index = num->n_scale; index > 0 && sptr < end; index--)
+      *sptr++ = BCD_CHAR(*nptr++);
+  }
+
+  /* Terminate the string. */
+  *sptr = '\0';
+  return (total <= len ? 0 : -1);
+}
+
+/* Fill STR with LEN random chars: mostly digits and leading zeros,
+   with now and then a sign, a point, a space, a letter, a high-bit
+   byte or a char next to '0' or '9', so that some are numbers and
+   some are not. */
+
+static void random_string (char *str, int len)
+{
+  static const char odd[] = "+-.. a/:\x80\xb0\xff";
+  int indx, bad, zeros;
+
+  if (len == 0)
+    return;
+  bad = random_below (4) == 0 ? random_below (len) : -1;  /* Not a digit. */
+  zeros = random_below (3) == 0 ? random_below (len + 1) : 0;
+  for (indx = 0; indx < len; indx++)
+  {
+    if (indx == bad)
+      str[indx] = odd[random_below (sizeof (odd) - 1)];
+    else if (indx < zeros)
+      str[indx] = '0';
+    else
+      str[indx] = '0' + random_below (10);
+  }
+  if (random_below (3) == 0)
+    str[0] = "+-"[random_below (2)];
+  if (len > 1 && random_below (2) == 0)
+    str[random_below (len)] = '.';
+}
+
+static int same_num (bc_num n1, bc_num n2)
+{
+  return n1->n_sign == n2->n_sign && n1->n_len == n2->n_len
+         && n1->n_scale == n2->n_scale
+         && memcmp (n1->n_value, n2->n_value,
+                    n1->n_len + n1->n_scale) == 0;
+}
+
+static void fail (const char *what, const char *str, int len)
+{
+  printf ("%s differs on \"%.*s\" (%d chars)\n", what, len > 60 ? 60 : len,
+          str, len);
+  exit (1);
+}
+
+/* Check the kernels on their own: every LOW..HIGH range number.c uses,
+   every length and start up to a few SIMD steps, and bytes just
+   inside and outside the range. */
+
+static void check_kernels (void)
+{
+  static const char ranges[][2] = { { '0', '9' }, { '0', '0' } };
+  char chars[128], got[128], want[128];
+  int range, start, count, indx, run;
+
+  for (range = 0; range < 2; range++)
+    for (start = 0; start < 32; start++)
+      for (count = 0; count + start <= 128; count++)
+      {
+        for (indx = 0; indx < 128; indx++)
+          chars[indx] = ranges[range][0]
+                        + random_below (ranges[range][1] - ranges[range][0]
+                                        + 1);
+        if (count > 0 && random_below (2) == 0)
+          chars[start + random_below (count)] =
+            "/:\x80\xff\x00+"[random_below (6)];
+        for (run = 0; run < count; run++)
+          if (chars[start + run] < ranges[range][0]
+              || chars[start + run] > ranges[range][1])
+            break;
+        if (_bc_ascii_run (chars + start, count, ranges[range][0],
+                           ranges[range][1]) != run)
+          fail ("_bc_ascii_run", chars + start, count);
+
+        for (indx = 0; indx < 128; indx++)
+          chars[indx] = random_below (10);
+        memset (got, 0x55, sizeof got);
+        memset (want, 0x55, sizeof want);
+        for (indx = 0; indx < count; indx++)
+          want[start + indx] = BCD_CHAR (chars[start + indx]);
+        _bc_ascii_shift (got + start, chars + start, count, '0');
+        if (memcmp (got, want, sizeof got) != 0)
+          fail ("_bc_ascii_shift", got + start, count);
+        _bc_ascii_shift (got + start, want + start, count, -'0');
+        if (memcmp (got + start, chars + start, count) != 0)
+          fail ("_bc_ascii_shift back", want + start, count);
+      }
+}
+
+int main (int argc, char **argv)
+{
+  bc_num got, want;
+  char *str, *got_buf, *want_buf, *got_str, *want_str;
+  int count, test, len, extra, scale, room, got_ret, want_ret;
+  int got_need, want_need;
+
+  count = argc > 1 ? atoi (argv[1]) : 200000;
+  bc_init_numbers ();
+  check_kernels ();
+
+  str = (char *) malloc (MAX_CHARS + 16);
+  got_buf = (char *) malloc (BUF_CHARS);
+  want_buf = (char *) malloc (BUF_CHARS);
+  got = NULL;
+  want = NULL;
+  for (test = 0; test < count; test++)
+  {
+    len = random_below (8) == 0 ? random_below (MAX_CHARS)
+                                : random_below (80);
+    random_string (str, len);
+    extra = random_below (16);                  /* Chars after the end. */
+    random_string (str + len, extra);
+    str[len + extra] = 0;
+    scale = random_below (4) == 0 ? INT_MAX : random_below (len + 2);
+
+    /* Parse the first LEN chars, and the whole string as a C string. */
+    bc_str2num_n (&got, str, len, scale);
+    ref_str2num_n (&want, str, len, scale);
+    if (!same_num (got, want))
+      fail ("bc_str2num_n", str, len);
+    bc_str2num (&got, str, scale);
+    ref_str2num_n (&want, str, len + extra, scale);
+    if (!same_num (got, want))
+      fail ("bc_str2num", str, len + extra);
+
+    /* Print it whole and into a buffer that may be too small. */
+    got_str = bc_num2str (got);
+    (void) ref_num2str_into (want, NULL, 0, &want_need);
+    want_str = (char *) malloc (want_need);
+    (void) ref_num2str_into (want, want_str, want_need, NULL);
+    if (strcmp (got_str, want_str) != 0)
+      fail ("bc_num2str", str, len + extra);
+    free (got_str);
+    free (want_str);
+
+    room = random_below (want_need + 3);
+    memset (got_buf, 0x55, BUF_CHARS);
+    memset (want_buf, 0x55, BUF_CHARS);
+    got_ret = bc_num2str_into (got, got_buf, room, &got_need);
+    want_ret = ref_num2str_into (want, want_buf, room, &want_need);
+    if (got_ret != want_ret || got_need != want_need
+        || memcmp (got_buf, want_buf, BUF_CHARS) != 0)
+      fail ("bc_num2str_into", str, len + extra);
+  }
+  bc_free_num (&got);
+  bc_free_num (&want);
+  free (str);
+  free (got_buf);
+  free (want_buf);
+  printf ("%d strings, no differences\n", count);
+  return 0;
+}